@@ -0,0 +1,57 @@
+/*
+ * Author: Nadav Markus
+ * The idle instances of the players' algorithms, so a worker doesn't pay for constructing an algorithm, its board
+ * and its containers for every match. Only algorithms that implement ResettableAlgorithm are kept, the rest are
+ * destroyed once their match is over, same as without a pool.
+ * Every worker owns a pool, so it requires no locking. A player never plays against itself, so a single idle
+ * instance per player is all a worker needs.
+ */
+
+#ifndef __ALGORITHM_POOL_H_
+#define __ALGORITHM_POOL_H_
+
+#include <memory>
+#include <vector>
+
+#include "PlayerAlgorithm.h"
+#include "PlayerRegistry.h"
+#include "ResettableAlgorithm.h"
+
+class AlgorithmPool
+{
+private:
+    const PlayerRegistry &registry;
+    /* Indexed by the player index. Null if the player has no idle instance. */
+    std::vector<std::unique_ptr<PlayerAlgorithm>> idle;
+
+public:
+    /* Note: The instances are destroyed along with the pool, so the players' shared objects must outlive it. */
+    AlgorithmPool(const PlayerRegistry &registry): registry(registry), idle(registry.size()) {}
+
+    AlgorithmPool(const AlgorithmPool &other) = delete;
+    AlgorithmPool& operator=(const AlgorithmPool &other) = delete;
+
+    std::unique_ptr<PlayerAlgorithm> acquire(playerIndex player)
+    {
+        if (nullptr == idle[player]) {
+            return registry.createAlgorithm(player);
+        }
+
+        return std::move(idle[player]);
+    }
+
+    /* Resets the algorithm and keeps it for the player's next match, if it supports that. */
+    void release(playerIndex player, std::unique_ptr<PlayerAlgorithm> algorithm)
+    {
+        ResettableAlgorithm *resettable = dynamic_cast<ResettableAlgorithm*>(algorithm.get());
+
+        if (nullptr == resettable) {
+            return;
+        }
+
+        resettable->reset();
+        idle[player] = std::move(algorithm);
+    }
+};
+
+#endif
@@ -2,11 +2,29 @@
 
 #include <functional>
 #include <memory>
+#include <atomic>
+#include <random>
 
 #include "TournamentManager.h"
+#include "SeedStreams.h"
 
 AlgorithmRegistration::AlgorithmRegistration(std::string id,
                                              std::function<std::unique_ptr<PlayerAlgorithm>()> algorithm)
 {
     TournamentManager::getInstance().onPlayerRegistration(id, algorithm);
-}
\ No newline at end of file
+}
+
+uint64_t AlgorithmRegistration::nextSeed()
+{
+    /* Taken once per process, so separate runs get different seeds. */
+    static const uint64_t process_key = [] {
+        std::random_device device;
+        return (static_cast<uint64_t>(device()) << 32) | device();
+    }();
+    static std::atomic<uint64_t> stream_count(0);
+    
+    thread_local const uint64_t stream_key = SeedStreams::mix(process_key + stream_count.fetch_add(1));
+    thread_local uint64_t drawn = 0;
+    
+    return SeedStreams::seedAt(stream_key, drawn++);
+}
@@ -4,11 +4,19 @@
 #include <functional>
 #include <memory>
 
+#include <stdint.h>
+
 #include "PlayerAlgorithm.h"
 
 class AlgorithmRegistration {
 public:
 	AlgorithmRegistration(std::string id, std::function<std::unique_ptr<PlayerAlgorithm>()>);
+	
+	/*
+	 * A fresh seed for an algorithm that is being created, so algorithms don't have to wait for the clock
+	 * to tick between instances. Every thread draws from its own stream, so this never blocks.
+	 */
+	static uint64_t nextSeed();
 };
 
 #define REGISTER_ALGORITHM(ID) \
@@ -10,6 +10,8 @@
 #define __AUTO_PLAYER_ALGORITHM_H_
 
 #include "PlayerAlgorithm.h"
+#include "SeededAlgorithm.h"
+#include "ResettableAlgorithm.h"
 #include "Board.h"
 #include "FightInfo.h"
 #include "Move.h"
@@ -21,6 +23,7 @@
 #include "ConcreteMove.h"
 #include "GameUtils.h"
 #include "ConcreteFightInfo.h"
+#include "AlgorithmRegistration.h"
 
 #include <memory>
 #include <vector>
@@ -31,12 +34,10 @@
 #include <random>
 #include <assert.h>
 #include <stdlib.h>
-#include <chrono>
-#include <thread>
 
 using piece_set_iterator = std::set<ConcretePoint>::iterator;
 
-class RSPPlayer_305261901 : public PlayerAlgorithm
+class RSPPlayer_305261901 final : public PlayerAlgorithm, public SeededAlgorithm, public ResettableAlgorithm
 {
 private:
     ConcreteBoard my_board_view;
@@ -459,9 +460,30 @@ public:
                             last_fight_result(nullptr)
     {
         /* Initialize RNG. */
-        /* Just to make sure that different players get different random seeds, we sleep for 2 milliseconds. */
-        std::this_thread::sleep_for(std::chrono::milliseconds(2));
-        gen.seed(std::chrono::system_clock::now().time_since_epoch().count());
+        setSeed(AlgorithmRegistration::nextSeed());
+    }
+    
+    /* The tournament seeds us again per match, so its matches can be replayed. */
+    virtual void setSeed(uint64_t seed) override
+    {
+        gen.seed(static_cast<std::default_random_engine::result_type>(seed ^ (seed >> 32)));
+    }
+    
+    /* Back to the state we were created in, so the tournament may hand us another match. */
+    virtual void reset() override
+    {
+        my_board_view.clear();
+        my_player_number = 0;
+        other_player = 0;
+        vector_to_fill = nullptr;
+        bool_generator.reset();
+        x_generator.reset();
+        y_generator.reset();
+        possible_opponent_flag_locations.clear();
+        my_move = false;
+        last_move = nullptr;
+        last_fight_result = nullptr;
+        setSeed(AlgorithmRegistration::nextSeed());
     }
 
     /* Note: This algorithm assumes that there is a single flag and two jokers. */
@@ -12,7 +12,7 @@ class BlockingQueue
 {
 private:
     std::queue<T> queue;
-    std::mutex queue_mutex;
+    mutable std::mutex queue_mutex;
     std::condition_variable queue_condition;
     
 public:
@@ -29,11 +29,25 @@ public:
             queue_condition.wait(lock, [&]{ return !queue.empty(); });
         }
         
-        T to_return = queue.front();
+        T to_return = std::move(queue.front());
         queue.pop();
         return to_return;
     }
     
+    /* Returns false instead of waiting if the queue is empty. */
+    bool tryPop(T &result)
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        
+        if (queue.empty()) {
+            return false;
+        }
+        
+        result = std::move(queue.front());
+        queue.pop();
+        return true;
+    }
+    
     void push(const T &element)
     {
         std::lock_guard<std::mutex> lock(queue_mutex);
@@ -41,11 +55,22 @@ public:
         queue_condition.notify_one();
     }
     
+    /* The lock is taken once for the whole batch, rather than once per element. */
     void push(std::vector<T> &elements)
     {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        
         for (const auto &element: elements) {
-            push(element);
+            queue.push(element);
         }
+        
+        queue_condition.notify_all();
+    }
+    
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        return queue.size();
     }
     
     bool empty() const
@@ -0,0 +1,78 @@
+/*
+ * Author: Nadav Markus
+ * Hands out consecutive ranges of job indices to the workers, so a worker pays for a single atomic operation
+ * per chunk rather than a queue round trip per job. With the guided policy the chunks start large and shrink
+ * as the remaining work shrinks (much like OpenMP's guided scheduling), so the workers still finish together.
+ */
+
+#ifndef __CHUNK_DISPENSER_H_
+#define __CHUNK_DISPENSER_H_
+
+#include <atomic>
+#include <algorithm>
+
+#include <stdlib.h>
+
+struct ChunkPolicy
+{
+    /* If true, chunk_size is the minimal chunk size. Otherwise, every chunk is exactly chunk_size jobs. */
+    bool guided;
+    size_t chunk_size;
+
+    ChunkPolicy(bool guided, size_t chunk_size): guided(guided), chunk_size(chunk_size) {}
+    static ChunkPolicy guidedPolicy() { return ChunkPolicy(true, 1); }
+    static ChunkPolicy fixedPolicy(size_t chunk_size) { return ChunkPolicy(false, chunk_size); }
+};
+
+class ChunkDispenser
+{
+private:
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    const size_t total;
+    const size_t worker_count;
+    const ChunkPolicy policy;
+    char padding0[CACHE_LINE_SIZE];
+    std::atomic<size_t> next;
+    char padding1[CACHE_LINE_SIZE];
+
+    size_t chunkSize(size_t remaining) const
+    {
+        if (!policy.guided) {
+            return policy.chunk_size;
+        }
+
+        /* Every worker gets half of its fair share of what is left. */
+        return std::max(policy.chunk_size, remaining / (2 * worker_count));
+    }
+
+public:
+    ChunkDispenser(size_t total, size_t worker_count, ChunkPolicy policy): total(total),
+                                                                           worker_count(std::max<size_t>(worker_count, 1)),
+                                                                           policy(policy),
+                                                                           padding0(),
+                                                                           next(0),
+                                                                           padding1() {}
+
+    /* Claims the next chunk, as the half open range [begin, end). Returns false once all the jobs were handed out. */
+    bool claim(size_t &begin, size_t &end)
+    {
+        size_t current = next.load(std::memory_order_relaxed);
+
+        for (;;) {
+            if (current >= total) {
+                return false;
+            }
+
+            size_t chunk_end = std::min(total, current + chunkSize(total - current));
+
+            if (next.compare_exchange_weak(current, chunk_end, std::memory_order_relaxed)) {
+                begin = current;
+                end = chunk_end;
+                return true;
+            }
+        }
+    }
+};
+
+#endif
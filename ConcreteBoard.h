@@ -76,6 +76,32 @@ public:
         board[where.getY() - 1][where.getX() - 1].reset();
     }
     
+    size_t countPieces(int player) const
+    {
+        size_t count = 0;
+        
+        for (size_t i = 0; i < Globals::N; ++i) {
+            for (size_t j = 0; j < Globals::M; ++j) {
+                if (player == board[i][j].getPlayer()) {
+                    count++;
+                }
+            }
+        }
+        
+        return count;
+    }
+    
+    /* Removes every piece, leaving the board as it was when created. */
+    void clear()
+    {
+        for (size_t i = 0; i < Globals::N; ++i) {
+            for (size_t j = 0; j < Globals::M; ++j) {
+                board[i][j].reset();
+                board[i][j].setPoint(j + 1, i + 1);
+            }
+        }
+    }
+    
     void updateJokerPiece(const Point &where, char new_joker_type)
     {
         board[where.getY() - 1][where.getX() - 1].setJokerRep(new_joker_type);
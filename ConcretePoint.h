@@ -44,7 +44,7 @@ class ConcretePoint : public Point
 };
 
 /* Used so we can insert points to a set. */
-bool operator <(const Point &a, const Point &b)
+inline bool operator <(const Point &a, const Point &b)
 {
     /* Perform lexicographical comparison */
     if (a.getX() < b.getX()) {
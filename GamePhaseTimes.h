@@ -0,0 +1,111 @@
+/*
+ * Author: Nadav Markus
+ * Tells where the time of a game goes - to the players' code, or to the referee. Every phase of a game is timed
+ * into a set of counters owned by the worker playing it, so the counters are never shared between threads.
+ * The timing is only compiled in when GAME_PHASE_TIMING is defined (make PHASE_TIMING=1). Otherwise,
+ * TIME_GAME_PHASE expands to nothing, and the game is exactly what it was without it.
+ */
+
+#ifndef __GAME_PHASE_TIMES_H_
+#define __GAME_PHASE_TIMES_H_
+
+#include <array>
+#include <chrono>
+
+#include <stdlib.h>
+#include <stdint.h>
+
+enum class GamePhase
+{
+    /* The players' getInitialPositions. */
+    INITIAL_POSITIONS,
+    POSITION_VERIFICATION,
+    /* Resolving the initial fights, including notifying the players of the initial board. */
+    INITIAL_MOVES,
+    /* The players' getMove and getJokerChange. */
+    MOVE_ALGORITHM,
+    MOVE_VERIFICATION,
+    /* Notifying the players of their opponent's moves and of the fights. */
+    MOVE_NOTIFICATIONS,
+    /* Resolving fights and applying the moves to the board. */
+    MOVE_BOARD,
+    /* Counting the pieces left, and writing the game over message if it was asked for. */
+    GAME_OVER,
+    COUNT
+};
+
+struct GamePhaseTimes
+{
+    static constexpr size_t PHASE_COUNT = static_cast<size_t>(GamePhase::COUNT);
+
+    std::array<uint64_t, PHASE_COUNT> nanoseconds;
+    std::array<uint64_t, PHASE_COUNT> calls;
+
+    GamePhaseTimes(): nanoseconds(), calls() {}
+
+    void add(GamePhase phase, std::chrono::nanoseconds duration)
+    {
+        nanoseconds[static_cast<size_t>(phase)] += static_cast<uint64_t>(duration.count());
+        calls[static_cast<size_t>(phase)]++;
+    }
+
+    void merge(const GamePhaseTimes &other)
+    {
+        for (size_t i = 0; i < PHASE_COUNT; ++i) {
+            nanoseconds[i] += other.nanoseconds[i];
+            calls[i] += other.calls[i];
+        }
+    }
+
+    static const char* getName(size_t phase)
+    {
+        static const char *names[PHASE_COUNT] = {
+            "initial positions",
+            "position verification",
+            "initial moves",
+            "move algorithm",
+            "move verification",
+            "move notifications",
+            "move board",
+            "game over"
+        };
+
+        return names[phase];
+    }
+};
+
+#ifdef GAME_PHASE_TIMING
+
+/* Times the rest of the enclosing scope, even if it is left by an exception. */
+class GamePhaseScope
+{
+private:
+    GamePhaseTimes *times;
+    GamePhase phase;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    GamePhaseScope(GamePhaseTimes *times, GamePhase phase): times(times),
+                                                             phase(phase),
+                                                             start(std::chrono::steady_clock::now()) {}
+
+    GamePhaseScope(const GamePhaseScope &other) = delete;
+    GamePhaseScope& operator=(const GamePhaseScope &other) = delete;
+
+    ~GamePhaseScope()
+    {
+        if (nullptr != times) {
+            times->add(phase, std::chrono::steady_clock::now() - start);
+        }
+    }
+};
+
+#define TIME_GAME_PHASE(times, phase) GamePhaseScope game_phase_scope((times), (phase))
+
+#else
+
+#define TIME_GAME_PHASE(times, phase)
+
+#endif
+
+#endif
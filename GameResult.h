@@ -0,0 +1,42 @@
+/*
+ * Author: Nadav Markus
+ * The outcome of a single game, as a compact record. This is all the tournament needs, so a game doesn't have
+ * to write its game over message - the message is built from the record only when someone asks for it.
+ */
+
+#ifndef __GAME_RESULT_H_
+#define __GAME_RESULT_H_
+
+#include <stdlib.h>
+
+enum class GameOverReason
+{
+    /* One of the players, or both, gave bad initial positions. The board is never played. */
+    BAD_POSITIONS,
+    /* One of the players, or both, has no flags left. */
+    FLAGS_CAPTURED,
+    /* The loser made a bad move. */
+    BAD_MOVE,
+    /* A tie, since the players ran out of moves. */
+    MOVES_EXHAUSTED
+};
+
+struct GameResult
+{
+    /* 0 in case of a tie. */
+    int winner;
+    GameOverReason reason;
+    /* The moves made by both players. */
+    size_t move_count;
+    /* The pieces left on the board at the end of the game. */
+    size_t player1_pieces;
+    size_t player2_pieces;
+
+    GameResult(): winner(0),
+                  reason(GameOverReason::MOVES_EXHAUSTED),
+                  move_count(0),
+                  player1_pieces(0),
+                  player2_pieces(0) {}
+};
+
+#endif
@@ -0,0 +1,578 @@
+/*
+ * Author: Nadav Markus
+ * The rules of the game - verifying the positions and the moves, resolving fights and applying everything to
+ * the board - along with the state of a match. Nothing here calls into the players, that is left to BasicGame
+ * (see Game.h), so the very same rules serve both the game that plays any two algorithms, and the games that are
+ * specialized for the types of the players.
+ */
+
+
+#ifndef __GAME_RULES_H_
+#define __GAME_RULES_H_
+
+#include "ConcreteBoard.h"
+#include "PiecePosition.h"
+#include "Globals.h"
+#include "GameUtils.h"
+#include "BaseError.h"
+#include "PositionError.h"
+#include "Board.h"
+#include "FightInfo.h"
+#include "ConcreteFightInfo.h"
+#include "JokerChange.h"
+#include "Move.h"
+#include "BadMoveError.h"
+#include "TimeoutError.h"
+#include "TimeBudget.h"
+#include "GamePhaseTimes.h"
+#include "GameResult.h"
+#include "MatchArena.h"
+
+#include <vector>
+#include <memory>
+#include <set>
+#include <map>
+#include <iostream>
+#include <assert.h>
+#include <stdlib.h>
+#include <sstream>
+#include <fstream>
+#include <chrono>
+
+class GameRules
+{
+protected:
+    using Coordinate = std::pair<unsigned int, unsigned int>;
+    /* The containers the game uses along a match, allocated from its arena. */
+    template <class Key>
+    using ArenaSet = std::set<Key, std::less<Key>, ArenaAllocator<Key>>;
+    template <class Key, class Value>
+    using ArenaMap = std::map<Key, Value, std::less<Key>, ArenaAllocator<std::pair<const Key, Value>>>;
+    
+    std::vector<std::unique_ptr<PiecePosition>> player1_positions;
+    std::vector<std::unique_ptr<PiecePosition>> player2_positions;
+    ConcreteBoard board;
+    size_t player1_flags;
+    size_t player2_flags;
+    /* The errors that made the players lose, if any. Only used for the game over message. */
+    std::string player1_error;
+    std::string player2_error;
+    /* Both are optional. Without a time budget, calls into the players are not measured at all. */
+    const TimeBudget *time_budget;
+    WatchdogSlot *watchdog_slot;
+    size_t player1_overruns;
+    size_t player2_overruns;
+    /* Optional, and only used if the phase timing is compiled in. */
+    GamePhaseTimes *phase_times;
+    size_t move_count;
+    MatchArena arena;
+    
+    /*
+     * Runs a single call into a player, measuring it against the time budget.
+     * Note: This method throws in case the player overran its budget and the policy is to forfeit.
+     */
+    template <class Call>
+    void timedCall(int player_number, bool is_move, Call call)
+    {
+        if (nullptr == time_budget) {
+            call();
+            return;
+        }
+        
+        std::chrono::nanoseconds budget = is_move ? time_budget->move_budget : time_budget->positions_budget;
+        
+        std::chrono::steady_clock::duration elapsed;
+        
+        {
+            WatchdogCall watchdog_call(watchdog_slot, player_number, budget);
+            auto start = std::chrono::steady_clock::now();
+            call();
+            elapsed = std::chrono::steady_clock::now() - start;
+        }
+        
+        if (elapsed <= budget) {
+            return;
+        }
+        
+        if (1 == player_number) {
+            player1_overruns++;
+        } else {
+            player2_overruns++;
+        }
+        
+        if (OverrunPolicy::FORFEIT == time_budget->policy) {
+            std::stringstream error;
+            error << "exceeded the time budget ("
+                  << std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() << " us)";
+            throw TimeoutError(error.str());
+        }
+    }
+    
+    void verifyJokerPositioning(int player, const PiecePosition &position) const
+    {
+        char masquerade_type = position.getJokerRep();
+        char piece_type = position.getPiece();
+        
+        if ('J' != piece_type) {
+            if ('#' != masquerade_type) {
+                std::stringstream error_message;
+                error_message << "Player " << player << " attempted to supply masquerade type for non joker";
+                throw PositionError(error_message.str());
+            }
+            return;
+        }
+        
+        /* If we got here, we are dealing with a joker. */
+        if (!GameUtils::isValidJokerMasqueradeType(masquerade_type)) {
+            std::stringstream error_message;
+            error_message << "Player " << player << " joker attempted to be invalid piece";
+            throw PositionError(error_message.str());
+        }
+    }
+    
+    /* Note: This method throws in order to let us know that something is wrong. */
+    void verifyPlayerPosition(int player, const std::vector<std::unique_ptr<PiecePosition>> &positions)
+    {
+        ArenaAllocator<Coordinate> allocator(arena);
+        ArenaSet<Coordinate> used_coords(allocator);
+        ArenaMap<char, unsigned int> piece_counters(allocator);
+        Coordinate cur_coord;
+        unsigned int x, y;
+        char type;
+        
+        for (auto const &position: positions) {
+            const Point &piece_point = position->getPosition();
+            x = piece_point.getX();
+            y = piece_point.getY();
+            
+            if ((x > Globals::M) || (y > Globals::N) || (1 > x) || (1 > y)) {
+                std::stringstream error_message;
+                error_message << "Player " << player << " bad piece position";
+                throw PositionError(error_message.str());
+            }
+            
+            cur_coord = std::make_pair(x, y);
+            
+            if (used_coords.count(cur_coord)) {
+                std::stringstream error_message;
+                error_message << "Player " << player << " two overlapping pieces at " << x << "," << y;
+                throw PositionError(error_message.str());
+            }
+            
+            used_coords.insert(cur_coord);
+            
+            type = position->getPiece();
+            
+            if (!GameUtils::isValidType(type)) {
+                std::stringstream error_message;
+                error_message << "Player " << player << " bad piece type";
+                throw PositionError(error_message.str());
+            }
+            
+            piece_counters[type]++;
+            
+            verifyJokerPositioning(player, *position);
+            
+            if (piece_counters[type] > Globals::getAllowedPieceCount(type)) {
+                std::stringstream error_message;
+                error_message << "Player " << player << " has too many pieces of type " << type;
+                throw PositionError(error_message.str());
+            }
+        }
+        
+        /* Verify flag count. */
+        if (piece_counters['F'] != Globals::getAllowedPieceCount('F')) {
+            std::stringstream error_message;
+            error_message << "Player " << player << " invalid flag count";
+            throw PositionError(error_message.str());
+        }
+    }
+    
+    /* Note: This function also updates the amount of flags for each player. */
+    int calculateWinner(const ConcretePiecePosition &player1_piece,
+                        const ConcretePiecePosition &player2_piece)
+    {
+        char piece1_type = player1_piece.effectivePieceType();
+        char piece2_type = player2_piece.effectivePieceType();
+        
+        /* Both pieces are destroyed in this case. */
+        if ('B' == piece1_type || 'B' == piece2_type || piece1_type == piece2_type) {
+            if ('F' == piece1_type) player1_flags--;
+            if ('F' == piece2_type) player2_flags--;
+            return 0;
+        }
+        
+        /* Player 2 won */
+        if (('F' == piece1_type) ||
+            ('S' == piece1_type && 'R' == piece2_type) ||
+            ('P' == piece1_type && 'S' == piece2_type) ||
+            ('R' == piece1_type && 'P' == piece2_type)) {
+            if ('F' == piece1_type) player1_flags--;
+            return 2;
+        }
+        
+        /* Player 1 won */
+        if (('F' == piece2_type) ||
+            ('S' == piece2_type && 'R' == piece1_type) ||
+            ('P' == piece2_type && 'S' == piece1_type) ||
+            ('R' == piece2_type && 'P' == piece1_type)) {
+            if ('F' == piece2_type) player2_flags--;
+            return 1;
+        }
+        
+        /* Should not happen. */
+        assert(false);
+        return -1;
+    }
+    
+    /*
+     * This method is called to resolve the initial conflicts between the players
+     * after the initial placement of pieces. The board is populated, and the fights are given back
+     * so the players may be notified of them.
+     */
+    void resolveInitialPositions(std::vector<unique_ptr<FightInfo>> &fights)
+    {
+         ArenaAllocator<Coordinate> allocator(arena);
+         ArenaMap<Coordinate, ConcretePiecePosition> point_to_piece_position(allocator);
+         Coordinate cur_coord;
+         
+         /* After iterating only on one player's positions, no possible conflict is possible. */
+         for (auto const &position: player1_positions) {
+            cur_coord = std::make_pair(position->getPosition().getX(), position->getPosition().getY());
+            point_to_piece_position[cur_coord] = ConcretePiecePosition(1, *position);
+         }
+         
+         /* When we go over the second one, we try to resolve possible conflicts via fights. */
+         for (auto const &position: player2_positions) {
+            cur_coord = std::make_pair(position->getPosition().getX(), position->getPosition().getY());
+            
+            if (point_to_piece_position.count(cur_coord)) {
+                ConcretePiecePosition pos(2, *position);
+                int conflict_result = calculateWinner(point_to_piece_position[cur_coord], pos);
+                
+                char player1_type = point_to_piece_position[cur_coord].getPiece();
+                char player2_type = pos.getPiece();
+                
+                switch(conflict_result) {
+                    case 2:
+                        point_to_piece_position[cur_coord] = pos;
+                        break;
+                        
+                    case 1:
+                        /* Nothing to do, winner is player 1 and he is already there. */
+                        break;
+                        
+                    case 0:
+                        /* Both players lost. */
+                        point_to_piece_position.erase(cur_coord);
+                        break;
+                }
+                
+                fights.push_back(std::make_unique<ConcreteFightInfo>(conflict_result,
+                                                                     player1_type,
+                                                                     player2_type,
+                                                                     position->getPosition().getX(),
+                                                                     position->getPosition().getY()));
+                
+            } else {
+                point_to_piece_position[cur_coord] = ConcretePiecePosition(2, *position);
+            }
+        }
+        
+        /* All right, we are finished. we can populate the board. */
+        for (auto const &point_to_piece: point_to_piece_position) {
+            board.addPosition(point_to_piece.second);
+        }
+    }
+    
+    /* Note: This method throws in order to let us know that something is wrong. */
+    void verifyCoordinatesInRange(const Point &point) const
+    {
+        if (static_cast<unsigned int>(point.getX()) > Globals::M || 0 == point.getX()) {
+            std::stringstream error;
+            error << point.getX() << "," <<  point.getY() << " is out of range";
+            throw BadMoveError(error.str());
+        }
+        
+        if (static_cast<unsigned int>(point.getY()) > Globals::N || 0 == point.getY()) {
+            std::stringstream error;
+            error << point.getX() << "," <<  point.getY() << " is out of range";
+            throw BadMoveError(error.str());
+        }
+    }
+    
+    /* Note: This method throws in order to let us know that something is wrong. */
+    void verifyMove(int player_number, const Move &move)
+    {
+        const Point &from = move.getFrom();
+        const Point &to = move.getTo();
+        
+        verifyCoordinatesInRange(from);
+        verifyCoordinatesInRange(to);
+        
+        int from_owning_player = board.getPlayer(from);
+        
+        /* Make sure the player attempted to move its own piece.. */
+        if (from_owning_player != player_number) {
+            throw BadMoveError(std::string("Attempted to move non owned piece"));
+        }
+        
+        int target_owning_player = board.getPlayer(to);
+        
+        /* You can't move pieces into spaces owned by yourself.. */
+        if (target_owning_player == player_number) {
+            throw BadMoveError(std::string("Attempted to move into self owned piece"));
+        }
+        
+        /* Make sure the player didn't attempt to move an unmovable piece. */
+        const ConcretePiecePosition &position = board.getPiece(from);
+        
+        char type = position.getPiece();
+        
+        if ('J' == type) type = position.getJokerRep();
+        
+        if (!GameUtils::isMovablePiece(type)) {
+            throw BadMoveError(std::string("Attempted to move non movable piece type"));
+        }
+        
+        /* Make sure that the diff in coordinates is only 1 in one axis */
+        int x_diff = abs(from.getX() - to.getX());
+        int y_diff = abs(from.getY() - to.getY());
+        
+        if (x_diff > 1 || y_diff > 1) {
+            throw BadMoveError(std::string("Attempted to move beyond 1 coord diff"));
+        }
+        
+        if (!((1 == x_diff) ^ (1 == y_diff))) {
+            throw BadMoveError(std::string("Attempted to change both coords at once"));
+        }
+        
+        /* All good! */
+    }
+    
+    /* Note: This method throws in order to let us know that something is wrong. */
+    void verifyJokerChange(int player_number, const JokerChange &joker_change)
+    {
+        const Point& where = joker_change.getJokerChangePosition();
+        verifyCoordinatesInRange(where);
+        char new_joker_type = joker_change.getJokerNewRep();
+        
+        if (!GameUtils::isValidJokerMasqueradeType(new_joker_type)) {
+            throw BadMoveError(std::string("Invalid joker type"));
+        }
+        
+        int owning_player = board.getPlayer(where);
+        
+        if (owning_player != player_number) {
+            throw BadMoveError(std::string("Attempted joker move on non owned piece"));
+        }
+    }
+    
+    void extractPieceTypes(const Point &to,
+                           const Point &from,
+                           char &player1_type,
+                           char &player2_type) const
+    {
+        const ConcretePiecePosition &toPiece = board.getPiece(to);
+        const ConcretePiecePosition &fromPiece = board.getPiece(from);
+    
+        if (1 == fromPiece.getPlayer()) {
+            assert(2 == toPiece.getPlayer());
+            player1_type = fromPiece.effectivePieceType();
+            player2_type = toPiece.effectivePieceType();
+            
+        } else if (1 == toPiece.getPlayer()) {
+            assert(2 == fromPiece.getPlayer());
+            player1_type = toPiece.effectivePieceType();
+            player2_type = fromPiece.effectivePieceType();
+
+        } else {
+            /* Should not happen. */
+            assert(false);
+        }
+    }
+    
+    /*
+     * Applies a verified move of the given player to the board. Returns whether the move ended in a fight,
+     * in which case the winner and the types of the pieces that took part in it are given back, for the players
+     * to be notified of.
+     */
+    bool applyMove(int player_number,
+                   const Move &move,
+                   int &winner,
+                   char &player1_type,
+                   char &player2_type)
+    {
+        TIME_GAME_PHASE(phase_times, GamePhase::MOVE_BOARD);
+        int other_player = board.getPlayer(move.getTo());
+        
+        const Point &from = move.getFrom();
+        const Point &to = move.getTo();
+        
+        /* Regular old move, can just apply. */
+        if (0 == other_player) {
+            board.movePiece(from, to);
+            return false;
+        }
+        
+        /* This surely means that the other player is the opponent! */
+        assert(other_player == 1 + (player_number % 2));
+        extractPieceTypes(to, from, player1_type, player2_type);
+        
+        if (1 == player_number) {
+            winner = calculateWinner(board.getPiece(from), board.getPiece(to));
+        } else {
+            winner = calculateWinner(board.getPiece(to), board.getPiece(from));
+        }
+        
+        /* Attacker won - update accordingly. */
+        if (winner == player_number) {
+            board.movePiece(from, to);
+        
+        /* Defender won - update accordingly. */
+        } else if (winner == other_player) {
+            board.invalidatePosition(from);
+            
+        /* Tie - both positions are invalidated. */
+        } else if (0 == winner) {
+            board.invalidatePosition(to);
+            board.invalidatePosition(from);
+            
+        } else {
+            /* Should not happen. */
+            assert(false);
+        }
+        
+        return true;
+    }
+    
+    /* Note: This method throws in case the joker change is invalid. */
+    void applyJokerChange(int player_number, const JokerChange &joker_change)
+    {
+        {
+            TIME_GAME_PHASE(phase_times, GamePhase::MOVE_VERIFICATION);
+            verifyJokerChange(player_number, joker_change);
+        }
+        
+        TIME_GAME_PHASE(phase_times, GamePhase::MOVE_BOARD);
+        board.updateJokerPiece(joker_change.getJokerChangePosition(), joker_change.getJokerNewRep());
+    }
+    
+    /* This function returns the winner if there is one, and -1 if the game should continue as usual. */
+    int isGameOver() const
+    {
+        if (0 == player1_flags || 0 == player2_flags) {
+            if (0 == player1_flags && 0 == player2_flags) {
+                return 0;
+            }
+            if (0 == player1_flags) {
+                return 2;
+            }
+            
+            return 1;
+        }
+        
+        return -1;
+    }
+    
+    GameRules(): player1_positions(),
+                 player2_positions(),
+                 board(),
+                 player1_flags(0),
+                 player2_flags(0),
+                 player1_error(),
+                 player2_error(),
+                 time_budget(nullptr),
+                 watchdog_slot(nullptr),
+                 player1_overruns(0),
+                 player2_overruns(0),
+                 phase_times(nullptr),
+                 move_count(0),
+                 arena() {}
+    
+public:
+    
+    /*
+     * Readies the game for another match, leaving it as if it was just created, except that the buffers of the
+     * positions, the errors and the arena are kept. The time budget and the phase counters are kept as well.
+     */
+    void reset()
+    {
+        player1_positions.clear();
+        player2_positions.clear();
+        board.clear();
+        player1_flags = 0;
+        player2_flags = 0;
+        player1_error.clear();
+        player2_error.clear();
+        player1_overruns = 0;
+        player2_overruns = 0;
+        move_count = 0;
+        arena.reset();
+    }
+    
+    /* The watchdog slot is optional, and is only used if a time budget is given. */
+    void setTimeBudget(const TimeBudget *time_budget, WatchdogSlot *watchdog_slot)
+    {
+        this->time_budget = time_budget;
+        this->watchdog_slot = watchdog_slot;
+    }
+    
+    /* The phases of the game are accumulated into the given counters, if the phase timing is compiled in. */
+    void setPhaseTimes(GamePhaseTimes *phase_times) { this->phase_times = phase_times; }
+    
+    const MatchArena& getArena() const { return arena; }
+    
+    /* The amount of calls in which the player exceeded its time budget. */
+    size_t getOverrunCount(int player) const { return (1 == player) ? player1_overruns : player2_overruns; }
+    
+    /* The game over message of the game that was just run, which must be the game that gave the result. */
+    std::string describeResult(const GameResult &result) const
+    {
+        TIME_GAME_PHASE(phase_times, GamePhase::GAME_OVER);
+        std::stringstream message;
+        
+        switch (result.reason) {
+            case GameOverReason::BAD_POSITIONS:
+                if (1 != result.winner) {
+                    message << "Player 1 lost due to bad position: " << player1_error << std::endl;
+                }
+                
+                if (2 != result.winner) {
+                    message << "Player 2 lost due bad position: " << player2_error << std::endl;
+                }
+                
+                break;
+                
+            case GameOverReason::FLAGS_CAPTURED:
+                if (0 == result.winner) {
+                    message << "Both players lost all flags." << std::endl;
+                } else {
+                    message << "Player " << (3 - result.winner) << " lost all flags." << std::endl;
+                }
+                
+                break;
+                
+            case GameOverReason::BAD_MOVE:
+                message << "Player " << (3 - result.winner) << " lost due to bad move: "
+                        << ((1 == result.winner) ? player2_error : player1_error) << std::endl;
+                break;
+                
+            case GameOverReason::MOVES_EXHAUSTED:
+                message << "Tie due to elapsed moves." << std::endl;
+                break;
+        }
+        
+        if (GameOverReason::BAD_POSITIONS == result.reason) {
+            message << "No board to print, problem in one of the position files." << std::endl;
+        } else {
+            message << "Board:" << std::endl;
+            message << board.printBoard();
+        }
+        
+        message << "Winner is " << result.winner << std::endl;
+        return message.str();
+    }
+};
+
+#endif
@@ -10,7 +10,7 @@
 
 namespace GameUtils
 {
-    bool isValidType(char type)
+    inline bool isValidType(char type)
     {
         switch (type) {
             case 'R':
@@ -31,7 +31,7 @@ namespace GameUtils
         }
     }
     
-    bool isValidJokerMasqueradeType(char type)
+    inline bool isValidJokerMasqueradeType(char type)
     {
         switch (type) {
             case 'R':
@@ -48,7 +48,7 @@ namespace GameUtils
         }
     }
     
-    bool isMovablePiece(char type)
+    inline bool isMovablePiece(char type)
     {
         switch (type) {
             case 'R':
@@ -63,7 +63,7 @@ namespace GameUtils
         }
     }
     
-    char getStrongerPiece(char type)
+    inline char getStrongerPiece(char type)
     {
         switch(type) {
             case 'R':
@@ -0,0 +1,98 @@
+/*
+ * Author: Nadav Markus
+ * A fixed size histogram of durations, for percentiles of the match latency. The buckets are spaced
+ * logarithmically, with a few buckets per power of two, so any percentile is within about 10% of the truth
+ * no matter how many durations are recorded, and recording one is a couple of shifts and an increment.
+ */
+
+#ifndef __LATENCY_HISTOGRAM_H_
+#define __LATENCY_HISTOGRAM_H_
+
+#include <array>
+#include <chrono>
+
+#include <stdlib.h>
+#include <stdint.h>
+
+class LatencyHistogram
+{
+private:
+    static constexpr size_t SUB_BUCKET_BITS = 3;
+    static constexpr size_t SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+    /* Enough for every duration in nanoseconds that fits in 64 bits. */
+    static constexpr size_t BUCKET_COUNT = 64 * SUB_BUCKET_COUNT;
+
+    std::array<size_t, BUCKET_COUNT> counts;
+    size_t total;
+
+    static size_t bucketOf(uint64_t nanoseconds)
+    {
+        if (nanoseconds < SUB_BUCKET_COUNT) {
+            return static_cast<size_t>(nanoseconds);
+        }
+
+        size_t octave = 63 - static_cast<size_t>(__builtin_clzll(nanoseconds));
+        size_t sub_bucket = static_cast<size_t>(nanoseconds >> (octave - SUB_BUCKET_BITS)) & (SUB_BUCKET_COUNT - 1);
+
+        return (octave - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT + sub_bucket;
+    }
+
+    /* The middle of the durations that fall into the given bucket. */
+    static double bucketMiddle(size_t bucket)
+    {
+        if (bucket < SUB_BUCKET_COUNT) {
+            return static_cast<double>(bucket);
+        }
+
+        size_t octave = bucket / SUB_BUCKET_COUNT + SUB_BUCKET_BITS - 1;
+        double width = static_cast<double>(1ULL << (octave - SUB_BUCKET_BITS));
+        double lowest = static_cast<double>(1ULL << octave) + (bucket % SUB_BUCKET_COUNT) * width;
+
+        return lowest + width / 2;
+    }
+
+public:
+    LatencyHistogram(): counts(), total(0) {}
+
+    void record(std::chrono::nanoseconds duration)
+    {
+        uint64_t nanoseconds = (duration.count() > 0) ? static_cast<uint64_t>(duration.count()) : 0;
+
+        counts[bucketOf(nanoseconds)]++;
+        total++;
+    }
+
+    void merge(const LatencyHistogram &other)
+    {
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            counts[i] += other.counts[i];
+        }
+
+        total += other.total;
+    }
+
+    size_t count() const { return total; }
+
+    /* The duration below which the given fraction of the recorded durations lie, in milliseconds. */
+    double percentileMs(double fraction) const
+    {
+        if (0 == total) {
+            return 0;
+        }
+
+        size_t rank = static_cast<size_t>(fraction * static_cast<double>(total - 1));
+        size_t seen = 0;
+
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            seen += counts[i];
+
+            if (seen > rank) {
+                return bucketMiddle(i) / (1000 * 1000);
+            }
+        }
+
+        return 0;
+    }
+};
+
+#endif
@@ -0,0 +1,160 @@
+/*
+ * Author: Nadav Markus
+ * A bump allocator for the engine's own allocations during a match, such as the nodes of the containers that
+ * verify and resolve the initial positions. Nothing is freed until the match is over, at which point the whole
+ * arena is reset at once. After a reset the memory is kept, so once an arena has seen a typical match, later
+ * matches are served from a single block without touching malloc.
+ * Every worker's game owns an arena, so it requires no locking.
+ * Note: Objects that are handed to the players, such as the fight infos, are owned through std::unique_ptr
+ * by the players' interface, so they can't live here.
+ */
+
+#ifndef __MATCH_ARENA_H_
+#define __MATCH_ARENA_H_
+
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+#include <stdlib.h>
+#include <stdint.h>
+
+class MatchArena
+{
+private:
+    static constexpr size_t INITIAL_BLOCK_SIZE = 4096;
+
+    struct Block
+    {
+        std::unique_ptr<char[]> memory;
+        size_t size;
+
+        Block(size_t size): memory(new char[size]), size(size) {}
+    };
+
+    std::vector<Block> blocks;
+    /* The block we are bumping in, and how much of it is used. */
+    size_t current_block;
+    size_t used;
+
+    /* The statistics of the current match. */
+    size_t match_bytes;
+    size_t match_allocations;
+    /* The statistics of all the matches so far, including the current one. */
+    size_t match_count;
+    size_t total_bytes;
+    size_t total_allocations;
+    size_t peak_bytes;
+
+    static size_t alignUp(size_t offset, size_t alignment) { return (offset + alignment - 1) & ~(alignment - 1); }
+
+public:
+    MatchArena(): blocks(),
+                  current_block(0),
+                  used(0),
+                  match_bytes(0),
+                  match_allocations(0),
+                  match_count(0),
+                  total_bytes(0),
+                  total_allocations(0),
+                  peak_bytes(0)
+    {
+        blocks.push_back(Block(INITIAL_BLOCK_SIZE));
+    }
+
+    MatchArena(const MatchArena &other) = delete;
+    MatchArena& operator=(const MatchArena &other) = delete;
+
+    /* Note: The alignment must be a power of two. */
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+    {
+        size_t offset = alignUp(used, alignment);
+
+        while (offset + size > blocks[current_block].size) {
+            current_block++;
+
+            if (blocks.size() == current_block) {
+                blocks.emplace_back(std::max(2 * blocks.back().size, size + alignment));
+            }
+
+            offset = alignUp(0, alignment);
+        }
+
+        used = offset + size;
+        match_bytes += size;
+        match_allocations++;
+        total_bytes += size;
+        total_allocations++;
+        peak_bytes = std::max(peak_bytes, match_bytes);
+
+        return blocks[current_block].memory.get() + offset;
+    }
+
+    /*
+     * Begins a new match, forgetting everything that was allocated so far. If the last match needed more than
+     * a single block, the blocks are merged into one that is big enough for it.
+     * Note: Everything allocated here must already be destroyed.
+     */
+    void reset()
+    {
+        if (blocks.size() > 1) {
+            size_t total_size = 0;
+
+            for (const auto &block: blocks) {
+                total_size += block.size;
+            }
+
+            blocks.clear();
+            blocks.emplace_back(total_size);
+        }
+
+        current_block = 0;
+        used = 0;
+        match_bytes = 0;
+        match_allocations = 0;
+        match_count++;
+    }
+
+    size_t getMatchBytes() const { return match_bytes; }
+    size_t getMatchAllocations() const { return match_allocations; }
+    size_t getMatchCount() const { return match_count; }
+    size_t getTotalBytes() const { return total_bytes; }
+    size_t getTotalAllocations() const { return total_allocations; }
+    /* The most bytes a single match allocated. */
+    size_t getPeakBytes() const { return peak_bytes; }
+};
+
+/* Lets the standard containers allocate from a MatchArena. Deallocating does nothing, the arena is reset instead. */
+template <class T>
+class ArenaAllocator
+{
+private:
+    template <class U> friend class ArenaAllocator;
+
+    MatchArena *arena;
+
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(MatchArena &arena): arena(&arena) {}
+
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U> &other): arena(other.arena) {}
+
+    T* allocate(size_t count) { return static_cast<T*>(arena->allocate(count * sizeof(T), alignof(T))); }
+
+    void deallocate(T *pointer, size_t count)
+    {
+        (void) pointer;
+        (void) count;
+    }
+
+    template <class U>
+    bool operator==(const ArenaAllocator<U> &other) const { return arena == other.arena; }
+
+    template <class U>
+    bool operator!=(const ArenaAllocator<U> &other) const { return arena != other.arena; }
+};
+
+#endif
@@ -0,0 +1,203 @@
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "MatchLog.h"
+
+/* Maps the whole file. If size is not zero, the file is first resized to it (the new part reads as zeroes). */
+bool MatchLog::map(const std::string &path, int flags, int protection, size_t size)
+{
+    fd = ::open(path.c_str(), flags, 0644);
+
+    if (-1 == fd) {
+        return false;
+    }
+
+    if (0 != size) {
+        if (0 != ftruncate(fd, static_cast<off_t>(size))) {
+            close();
+            return false;
+        }
+    } else {
+        struct stat file_stat;
+
+        if (0 != fstat(fd, &file_stat) || static_cast<size_t>(file_stat.st_size) < sizeof(Header)) {
+            close();
+            return false;
+        }
+
+        size = static_cast<size_t>(file_stat.st_size);
+    }
+
+    memory = mmap(nullptr, size, protection, MAP_SHARED, fd, 0);
+
+    if (MAP_FAILED == memory) {
+        memory = nullptr;
+        close();
+        return false;
+    }
+
+    mapped_size = size;
+    header = static_cast<Header*>(memory);
+    records = reinterpret_cast<std::atomic<uint64_t>*>(static_cast<char*>(memory) + sizeof(Header));
+    return true;
+}
+
+void MatchLog::close()
+{
+    if (nullptr != memory) {
+        (void) msync(memory, mapped_size, MS_SYNC);
+        (void) munmap(memory, mapped_size);
+    }
+
+    if (-1 != fd) {
+        (void) ::close(fd);
+    }
+
+    fd = -1;
+    memory = nullptr;
+    mapped_size = 0;
+    header = nullptr;
+    records = nullptr;
+}
+
+bool MatchLog::create(const std::string &path, uint64_t match_count, uint64_t fingerprint, uint64_t master_seed)
+{
+    close();
+
+    if (!map(path, O_RDWR | O_CREAT | O_TRUNC, PROT_READ | PROT_WRITE, fileSize(match_count))) {
+        return false;
+    }
+
+    header->magic = MAGIC;
+    header->match_count = match_count;
+    header->fingerprint = fingerprint;
+    header->master_seed = master_seed;
+    next.store(0, std::memory_order_relaxed);
+
+    /* The header is flushed right away, so even a log without a single record can be resumed. */
+    (void) msync(memory, sizeof(Header), MS_SYNC);
+    return true;
+}
+
+/* Maps an existing log, and makes sure it was written for the given schedule. */
+bool MatchLog::mapExisting(const std::string &path,
+                           int flags,
+                           int protection,
+                           uint64_t match_count,
+                           uint64_t fingerprint)
+{
+    close();
+
+    if (!map(path, flags, protection, 0)) {
+        return false;
+    }
+
+    if (MAGIC != header->magic
+        || match_count != header->match_count
+        || fingerprint != header->fingerprint
+        || fileSize(match_count) != mapped_size) {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+bool MatchLog::parseRecord(uint64_t record, uint64_t match_count, uint32_t &match_index, int &winner)
+{
+    uint32_t low = static_cast<uint32_t>(record);
+
+    match_index = static_cast<uint32_t>(record >> 32);
+    winner = static_cast<int>(low & 0xff);
+
+    return RECORD_TAG == (low & ~0xffU) && match_index < match_count && winner <= 2;
+}
+
+bool MatchLog::open(const std::string &path,
+                    uint64_t match_count,
+                    uint64_t fingerprint,
+                    uint64_t master_seed,
+                    std::vector<MatchLogEntry> &entries)
+{
+    if (!mapExisting(path, O_RDWR, PROT_READ | PROT_WRITE, match_count, fingerprint)) {
+        return false;
+    }
+
+    if (master_seed != header->master_seed) {
+        close();
+        return false;
+    }
+
+    /*
+     * A worker that died between claiming a slot and filling it leaves a zeroed slot behind, and the workers
+     * that claimed later slots may have filled theirs. We move the valid records to the front, so the next
+     * run has room for all the matches that are left.
+     * A record is always stored to its new slot before its old slot is cleared, so if we are killed midway,
+     * the worst left behind is a duplicate, which the next open drops.
+     */
+    std::vector<bool> seen(match_count, false);
+    size_t count = 0;
+
+    for (size_t i = 0; i < match_count; ++i) {
+        uint64_t record = records[i].load(std::memory_order_relaxed);
+        uint32_t match_index;
+        int winner;
+
+        if (!parseRecord(record, match_count, match_index, winner) || seen[match_index]) {
+            records[i].store(0, std::memory_order_relaxed);
+            continue;
+        }
+
+        seen[match_index] = true;
+        entries.push_back(MatchLogEntry(match_index, winner));
+
+        if (count != i) {
+            records[count].store(record, std::memory_order_relaxed);
+            records[i].store(0, std::memory_order_relaxed);
+        }
+
+        count++;
+    }
+
+    next.store(count, std::memory_order_relaxed);
+    (void) msync(memory, mapped_size, MS_SYNC);
+    return true;
+}
+
+bool MatchLog::read(const std::string &path,
+                    uint64_t match_count,
+                    uint64_t fingerprint,
+                    std::vector<MatchLogEntry> &entries,
+                    uint64_t &master_seed)
+{
+    if (!mapExisting(path, O_RDONLY, PROT_READ, match_count, fingerprint)) {
+        return false;
+    }
+
+    master_seed = header->master_seed;
+
+    std::vector<bool> seen(match_count, false);
+
+    for (size_t i = 0; i < match_count; ++i) {
+        uint32_t match_index;
+        int winner;
+
+        if (!parseRecord(records[i].load(std::memory_order_relaxed), match_count, match_index, winner)
+            || seen[match_index]) {
+            continue;
+        }
+
+        seen[match_index] = true;
+        entries.push_back(MatchLogEntry(match_index, winner));
+    }
+
+    close();
+    return true;
+}
@@ -0,0 +1,106 @@
+/*
+ * Author: Nadav Markus
+ * An append-only log of finished matches, kept in a memory mapped file so a tournament that dies midway
+ * can be resumed. Every record is a single 64 bit word holding the match index and its winner, and the
+ * workers append with one atomic add and one atomic store - no locking and no system calls.
+ * Since the file is mapped shared, everything appended survives a crash of the tournament process. It is
+ * only flushed to the disk when the log is closed, so the records of the last seconds may be lost if the
+ * machine itself goes down.
+ */
+
+#ifndef __MATCH_LOG_H_
+#define __MATCH_LOG_H_
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <stdlib.h>
+#include <stdint.h>
+
+/* A match that was found in the log. */
+struct MatchLogEntry
+{
+    uint32_t match_index;
+    int winner;
+
+    MatchLogEntry(uint32_t match_index, int winner): match_index(match_index), winner(winner) {}
+};
+
+class MatchLog
+{
+private:
+    static constexpr uint64_t MAGIC = 0x32474f4c53505200ULL;
+    /* Written along with every record, so a zeroed (never written) slot can't be mistaken for one. */
+    static constexpr uint32_t RECORD_TAG = 0x52505300;
+
+    struct Header
+    {
+        uint64_t magic;
+        uint64_t match_count;
+        /* Identifies the schedule the log was written for, so a log of another tournament is never resumed. */
+        uint64_t fingerprint;
+        /* The matches are seeded from it, so resuming with another seed would mix two tournaments in one log. */
+        uint64_t master_seed;
+    };
+
+    int fd;
+    void *memory;
+    size_t mapped_size;
+    Header *header;
+    std::atomic<uint64_t> *records;
+    std::atomic<size_t> next;
+
+    static size_t fileSize(uint64_t match_count) { return sizeof(Header) + match_count * sizeof(uint64_t); }
+    bool map(const std::string &path, int flags, int protection, size_t size);
+    bool mapExisting(const std::string &path, int flags, int protection, uint64_t match_count, uint64_t fingerprint);
+    /* Returns false if the record is not a valid record of a log with the given amount of matches. */
+    static bool parseRecord(uint64_t record, uint64_t match_count, uint32_t &match_index, int &winner);
+    void close();
+
+public:
+    MatchLog(): fd(-1), memory(nullptr), mapped_size(0), header(nullptr), records(nullptr), next(0) {}
+    MatchLog(const MatchLog &other) = delete;
+    MatchLog& operator=(const MatchLog &other) = delete;
+    /* Flushes the log to the disk. */
+    ~MatchLog() { close(); }
+
+    /* Starts an empty log for the given schedule and seed, replacing the file if it exists. */
+    bool create(const std::string &path, uint64_t match_count, uint64_t fingerprint, uint64_t master_seed);
+
+    /*
+     * Opens the log of an interrupted run, and returns the matches it recorded. Returns false if there is no
+     * such log, or it was written for another schedule or seed. The records are compacted, so slots that were
+     * claimed by a worker that died before filling them are reused.
+     */
+    bool open(const std::string &path,
+              uint64_t match_count,
+              uint64_t fingerprint,
+              uint64_t master_seed,
+              std::vector<MatchLogEntry> &entries);
+
+    /*
+     * Reads the matches recorded in a log, such as the log of a shard, without changing it, along with the seed
+     * it was written with. The log is closed once this returns, and it can't be appended to. Returns false if
+     * there is no such log, or it was written for another schedule.
+     */
+    bool read(const std::string &path,
+              uint64_t match_count,
+              uint64_t fingerprint,
+              std::vector<MatchLogEntry> &entries,
+              uint64_t &master_seed);
+
+    /* May be called by any worker. Every match must be appended at most once. */
+    void append(uint32_t match_index, int winner)
+    {
+        uint64_t record = (static_cast<uint64_t>(match_index) << 32) | RECORD_TAG | static_cast<uint32_t>(winner);
+        size_t slot = next.fetch_add(1, std::memory_order_relaxed);
+
+        records[slot].store(record, std::memory_order_relaxed);
+    }
+};
+
+/* Each record must be written by a single instruction, so a crash can't leave half of one behind. */
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "Log records should be plain 64 bit words");
+
+#endif
@@ -0,0 +1,72 @@
+/*
+ * Author: Nadav Markus
+ * Hands out the matches of the schedule as they are generated, so the schedule is never materialized and
+ * workers can start playing as soon as the first batch is out. The schedule itself is not thread safe, so
+ * batches are taken under a lock - generating a match costs a few instructions, so this is cheap as long as
+ * the batches are not tiny. Matches that were already played by a resumed tournament are skipped, and so are
+ * the matches that belong to other shards, when the tournament is split between processes.
+ */
+
+#ifndef __MATCH_SOURCE_H_
+#define __MATCH_SOURCE_H_
+
+#include <mutex>
+#include <vector>
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "WorkItem.h"
+#include "RoundRobinSchedule.h"
+
+class MatchSource
+{
+private:
+    std::mutex source_mutex;
+    RoundRobinSchedule schedule;
+    /* Indexed by the match index. Empty if no match was played yet. */
+    const std::vector<bool> &finished;
+    /* Our shard gets every shard_count'th match, so the shards get a similar share of every part of the schedule. */
+    const size_t shard_index;
+    const size_t shard_count;
+
+public:
+    /* Note: The finished matches must outlive the source. */
+    MatchSource(size_t player_count,
+                uint32_t required_games,
+                const std::vector<bool> &finished,
+                size_t shard_index,
+                size_t shard_count): source_mutex(),
+                                     schedule(player_count, required_games),
+                                     finished(finished),
+                                     shard_index(shard_index),
+                                     shard_count(shard_count) {}
+
+    MatchSource(const MatchSource &other) = delete;
+    MatchSource& operator=(const MatchSource &other) = delete;
+
+    /* Appends up to max_count matches to the batch. Returns the amount appended, which is zero once we are done. */
+    size_t take(size_t max_count, std::vector<WorkItem> &batch)
+    {
+        std::lock_guard<std::mutex> lock(source_mutex);
+        size_t taken = 0;
+        WorkItem work_item;
+
+        while (taken < max_count && schedule.next(work_item)) {
+            if (shard_index != work_item.index % shard_count) {
+                continue;
+            }
+
+            if (!finished.empty() && finished[work_item.index]) {
+                continue;
+            }
+
+            batch.push_back(work_item);
+            taken++;
+        }
+
+        return taken;
+    }
+};
+
+#endif
@@ -0,0 +1,195 @@
+/*
+ * Author: Nadav Markus
+ * Hardware performance counters of the calling thread, read through perf_event_open: cycles, instructions,
+ * cache misses and branch misses. The four are opened as a single group, so they are always scheduled together
+ * and describe the very same stretch of code. Only user space is counted, which works with the default
+ * perf_event_paranoid. Opening them may still fail (no PMU in a VM, a seccomp filter, etc.), in which case
+ * the reason is kept and nothing is counted.
+ * Note: Players that run in sandbox processes are not counted, as the counters only follow the calling thread.
+ */
+
+#ifndef __PERF_COUNTERS_H_
+#define __PERF_COUNTERS_H_
+
+#include <array>
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+struct PerfSample
+{
+    uint64_t cycles;
+    uint64_t instructions;
+    uint64_t cache_misses;
+    uint64_t branch_misses;
+
+    PerfSample(): cycles(0), instructions(0), cache_misses(0), branch_misses(0) {}
+
+    void merge(const PerfSample &other)
+    {
+        cycles += other.cycles;
+        instructions += other.instructions;
+        cache_misses += other.cache_misses;
+        branch_misses += other.branch_misses;
+    }
+};
+
+/* The counters of all the matches a single player took part in. */
+struct PerfTotals
+{
+    PerfSample counters;
+    size_t matches;
+    /* The moves of both sides, as the counters can't tell the players of a match apart. */
+    size_t moves;
+
+    PerfTotals(): counters(), matches(0), moves(0) {}
+
+    void add(const PerfSample &sample, size_t match_moves)
+    {
+        counters.merge(sample);
+        matches++;
+        moves += match_moves;
+    }
+
+    void merge(const PerfTotals &other)
+    {
+        counters.merge(other.counters);
+        matches += other.matches;
+        moves += other.moves;
+    }
+};
+
+class PerfCounters
+{
+private:
+    static constexpr size_t EVENT_COUNT = 4;
+
+    /* The layout of a group read, with PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | RUNNING. */
+    struct GroupReading
+    {
+        uint64_t event_count;
+        uint64_t time_enabled;
+        uint64_t time_running;
+        uint64_t values[EVENT_COUNT];
+    };
+
+    /* The first is the group leader. */
+    std::array<int, EVENT_COUNT> fds;
+    bool is_open;
+    /* The errno of the failed perf_event_open, if the counters are unavailable. */
+    int open_error;
+
+    static int openEvent(uint64_t config, int group_fd)
+    {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = config;
+        /* The members follow the leader, so only the leader starts disabled. */
+        attr.disabled = (-1 == group_fd) ? 1 : 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        /* The calling thread, on any cpu. */
+        return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0));
+    }
+
+    void close()
+    {
+        for (auto &fd: fds) {
+            if (-1 != fd) {
+                (void) ::close(fd);
+                fd = -1;
+            }
+        }
+
+        is_open = false;
+    }
+
+public:
+    PerfCounters(): fds(), is_open(false), open_error(0)
+    {
+        fds.fill(-1);
+    }
+
+    PerfCounters(const PerfCounters &other) = delete;
+    PerfCounters& operator=(const PerfCounters &other) = delete;
+
+    ~PerfCounters() { close(); }
+
+    /* Must be called by the thread that is going to be counted. Returns false if the counters are unavailable. */
+    bool open()
+    {
+        static const uint64_t configs[EVENT_COUNT] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_MISSES,
+            PERF_COUNT_HW_BRANCH_MISSES
+        };
+
+        for (size_t i = 0; i < EVENT_COUNT; ++i) {
+            fds[i] = openEvent(configs[i], fds[0]);
+
+            if (-1 == fds[i]) {
+                open_error = errno;
+                close();
+                return false;
+            }
+        }
+
+        is_open = true;
+        return true;
+    }
+
+    bool isOpen() const { return is_open; }
+
+    int getOpenError() const { return open_error; }
+
+    void start()
+    {
+        (void) ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        (void) ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    /*
+     * Returns false if nothing was counted, such as when the group never got onto the PMU. If the group shared
+     * the PMU with other events, the counts are scaled up to the whole time it was enabled.
+     */
+    bool stop(PerfSample &sample)
+    {
+        (void) ioctl(fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+        GroupReading reading;
+
+        if (static_cast<ssize_t>(sizeof(reading)) != read(fds[0], &reading, sizeof(reading))
+            || EVENT_COUNT != reading.event_count
+            || 0 == reading.time_running) {
+            return false;
+        }
+
+        double scale = static_cast<double>(reading.time_enabled) / static_cast<double>(reading.time_running);
+        uint64_t *values[EVENT_COUNT] = {
+            &sample.cycles,
+            &sample.instructions,
+            &sample.cache_misses,
+            &sample.branch_misses
+        };
+
+        for (size_t i = 0; i < EVENT_COUNT; ++i) {
+            *values[i] = static_cast<uint64_t>(static_cast<double>(reading.values[i]) * scale);
+        }
+
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,68 @@
+/*
+ * Author: Nadav Markus
+ * Runs a report on a background thread every interval, until destroyed.
+ * The report runs concurrently with the workers, so it must only read state that is safe to read while
+ * they update it (for example, the relaxed counters of the score shards).
+ */
+
+#ifndef __PERIODIC_REPORTER_H_
+#define __PERIODIC_REPORTER_H_
+
+#include <functional>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+class PeriodicReporter
+{
+private:
+    std::chrono::nanoseconds interval;
+    std::function<void()> report;
+    std::mutex stop_mutex;
+    std::condition_variable stop_condition;
+    bool should_stop;
+    std::thread thread;
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(stop_mutex);
+        auto next = std::chrono::steady_clock::now() + interval;
+
+        while (!should_stop) {
+            /* We wait until the deadline rather than for the interval, so spurious wake ups don't add reports. */
+            if (std::cv_status::timeout == stop_condition.wait_until(lock, next)) {
+                report();
+                next += interval;
+            }
+        }
+    }
+
+public:
+    PeriodicReporter(std::chrono::nanoseconds interval,
+                     std::function<void()> report): interval(interval),
+                                                    report(report),
+                                                    stop_mutex(),
+                                                    stop_condition(),
+                                                    should_stop(false),
+                                                    thread()
+    {
+        thread = std::thread(&PeriodicReporter::run, this);
+    }
+
+    PeriodicReporter(const PeriodicReporter &other) = delete;
+    PeriodicReporter& operator=(const PeriodicReporter &other) = delete;
+
+    ~PeriodicReporter()
+    {
+        {
+            std::lock_guard<std::mutex> lock(stop_mutex);
+            should_stop = true;
+        }
+
+        stop_condition.notify_one();
+        thread.join();
+    }
+};
+
+#endif
@@ -0,0 +1,121 @@
+/*
+ * Author: Nadav Markus
+ * The table of all the registered players. Players register while the shared objects are loaded,
+ * and once loading is done the registry is frozen into a sorted, contiguous table. From that point
+ * on the registry is immutable, so worker threads may look players up concurrently without locking.
+ * Registrations after the freeze are rejected.
+ */
+
+#ifndef __PLAYER_REGISTRY_H_
+#define __PLAYER_REGISTRY_H_
+
+#include <memory>
+#include <vector>
+#include <functional>
+#include <string>
+#include <map>
+#include <mutex>
+#include <algorithm>
+#include <cassert>
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "PlayerAlgorithm.h"
+
+using playerAlgorithmPtr = std::function<std::unique_ptr<PlayerAlgorithm>()>;
+/* Players are interned when the registry is frozen. Everything past loading refers to players by this index. */
+using playerIndex = uint32_t;
+
+class PlayerRegistry
+{
+private:
+    /* Registrations may arrive from more than one thread while loading, so they are serialized. */
+    std::mutex registration_mutex;
+    /* A player that registers twice under the same id gets its algorithm replaced. */
+    std::map<std::string, playerAlgorithmPtr> pending;
+    bool frozen;
+
+    /* Only valid once frozen. Both vectors are indexed by the player index, and sorted by the id. */
+    std::vector<std::string> sorted_ids;
+    std::vector<playerAlgorithmPtr> algorithms;
+
+public:
+    PlayerRegistry(): registration_mutex(), pending(), frozen(false), sorted_ids(), algorithms() {}
+
+    /* Returns false if the registry is already frozen, in which case the player is ignored. */
+    bool registerPlayer(const std::string &id, playerAlgorithmPtr algorithm)
+    {
+        std::lock_guard<std::mutex> lock(registration_mutex);
+
+        if (frozen) {
+            return false;
+        }
+
+        pending[id] = algorithm;
+        return true;
+    }
+
+    /* Replaces the algorithm of a player that already registered. Returns false if there is no such player. */
+    bool replaceAlgorithm(const std::string &id, playerAlgorithmPtr algorithm)
+    {
+        std::lock_guard<std::mutex> lock(registration_mutex);
+
+        auto it = pending.find(id);
+
+        if (frozen || pending.end() == it) {
+            return false;
+        }
+
+        it->second = algorithm;
+        return true;
+    }
+
+    /*
+     * Builds the immutable table. The indices follow the order of the ids, so they don't depend
+     * on the order in which the players happened to register.
+     * Note: Worker threads must only be started after this returns.
+     */
+    void freeze()
+    {
+        std::lock_guard<std::mutex> lock(registration_mutex);
+
+        if (frozen) {
+            return;
+        }
+
+        sorted_ids.reserve(pending.size());
+        algorithms.reserve(pending.size());
+
+        /* The map is already ordered by the id. */
+        for (auto &pair: pending) {
+            sorted_ids.push_back(pair.first);
+            algorithms.push_back(std::move(pair.second));
+        }
+
+        pending.clear();
+        frozen = true;
+    }
+
+    /* The rest of the interface is only valid once frozen. */
+    size_t size() const { return sorted_ids.size(); }
+
+    const std::string& getId(playerIndex player) const { return sorted_ids[player]; }
+
+    std::unique_ptr<PlayerAlgorithm> createAlgorithm(playerIndex player) const { return algorithms[player](); }
+
+    /* Returns false if there is no such player. */
+    bool findIndex(const std::string &id, playerIndex &result) const
+    {
+        auto it = std::lower_bound(sorted_ids.begin(), sorted_ids.end(), id);
+
+        if (sorted_ids.end() == it || *it != id) {
+            return false;
+        }
+
+        result = static_cast<playerIndex>(std::distance(sorted_ids.begin(), it));
+        return true;
+    }
+};
+
+#endif
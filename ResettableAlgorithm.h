@@ -0,0 +1,19 @@
+/*
+ * Author: Nadav Markus
+ * An optional interface for player algorithms that can play more than one match. An algorithm that implements it
+ * is reset once its match is over, and may then be handed another match instead of a fresh instance. After reset,
+ * the algorithm must behave exactly like a newly created one. Algorithms that don't implement it are created anew
+ * for every match.
+ */
+
+#ifndef __RESETTABLE_ALGORITHM_H_
+#define __RESETTABLE_ALGORITHM_H_
+
+class ResettableAlgorithm
+{
+public:
+    virtual void reset() = 0;
+    virtual ~ResettableAlgorithm() {}
+};
+
+#endif
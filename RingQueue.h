@@ -0,0 +1,354 @@
+/*
+ * Author: Nadav Markus
+ * A lock free, bounded, multi producer multi consumer queue, in the spirit of Dmitry Vyukov's
+ * bounded queue. Every cell carries a sequence number that tells whether it is ready to be written
+ * or read in the current lap, so producers and consumers only contend on a single CAS each.
+ * It exposes the same push/pop surface as BlockingQueue, with batched variants on top of it.
+ * Blocking operations spin for a while before parking on a condition variable, so a busy queue
+ * never touches the lock.
+ */
+
+#ifndef __RING_QUEUE_H_
+#define __RING_QUEUE_H_
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <type_traits>
+#include <utility>
+#include <iterator>
+
+#include <stdlib.h>
+
+template <class T>
+class RingQueue
+{
+private:
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+    /* The amount of failed attempts before we start yielding, and later parking. */
+    static constexpr size_t SPIN_COUNT = 64;
+    static constexpr size_t YIELD_COUNT = 64;
+
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+        T* element() { return reinterpret_cast<T*>(&storage); }
+    };
+
+    const size_t mask;
+    std::unique_ptr<Cell[]> cells;
+
+    /* The positions are kept on separate cache lines, since producers and consumers update them independently. */
+    char padding0[CACHE_LINE_SIZE];
+    std::atomic<size_t> enqueue_position;
+    char padding1[CACHE_LINE_SIZE];
+    std::atomic<size_t> dequeue_position;
+    char padding2[CACHE_LINE_SIZE];
+
+    /* Used only for parking, once spinning didn't help. */
+    std::mutex park_mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    std::atomic<size_t> parked_consumers;
+    std::atomic<size_t> parked_producers;
+
+    static size_t roundUpToPowerOfTwo(size_t value)
+    {
+        size_t result = 2;
+
+        while (result < value) {
+            result <<= 1;
+        }
+
+        return result;
+    }
+
+    /*
+     * Claims up to max_count consecutive cells, starting at the given position, whose sequence is position + offset.
+     * A producer uses offset 0 (the cell is free in this lap) and a consumer uses offset 1 (the cell was written).
+     * Returns the amount of claimed cells, and the position of the first one.
+     */
+    size_t claim(std::atomic<size_t> &position, size_t offset, size_t max_count, size_t &first)
+    {
+        if (0 == max_count) {
+            return 0;
+        }
+
+        size_t current = position.load(std::memory_order_relaxed);
+
+        for (;;) {
+            size_t count = 0;
+
+            while (count < max_count) {
+                Cell &cell = cells[(current + count) & mask];
+                size_t sequence = cell.sequence.load(std::memory_order_acquire);
+
+                if (sequence != current + count + offset) {
+                    break;
+                }
+
+                count++;
+            }
+
+            if (0 == count) {
+                Cell &cell = cells[current & mask];
+                size_t sequence = cell.sequence.load(std::memory_order_acquire);
+
+                /* The first cell is not ready for us yet, which means the queue is full (or empty). */
+                if (static_cast<long>(sequence - (current + offset)) < 0) {
+                    return 0;
+                }
+
+                /* Someone else advanced the position in the meantime. */
+                current = position.load(std::memory_order_relaxed);
+                continue;
+            }
+
+            if (position.compare_exchange_weak(current, current + count, std::memory_order_relaxed)) {
+                first = current;
+                return count;
+            }
+        }
+    }
+
+    void publish(size_t position, size_t offset)
+    {
+        cells[position & mask].sequence.store(position + offset, std::memory_order_release);
+    }
+
+    void wakeConsumers()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (0 != parked_consumers.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(park_mutex);
+            not_empty.notify_all();
+        }
+    }
+
+    void wakeProducers()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (0 != parked_producers.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(park_mutex);
+            not_full.notify_all();
+        }
+    }
+
+    /*
+     * Spins, yields and finally parks until the attempt succeeds.
+     * Note: Once parked, the attempt runs under the park lock, so it must only claim cells. Publishing them
+     * and waking the other side is left to the caller, after this returns.
+     */
+    template <class Attempt>
+    void waitFor(Attempt attempt, std::atomic<size_t> &parked, std::condition_variable &condition)
+    {
+        for (size_t i = 0; i < SPIN_COUNT + YIELD_COUNT; ++i) {
+            if (attempt()) {
+                return;
+            }
+
+            if (i >= SPIN_COUNT) {
+                std::this_thread::yield();
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(park_mutex);
+        parked.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        /* The timeout is only a safety net, the other side notifies us once it made progress. */
+        while (!attempt()) {
+            condition.wait_for(lock, std::chrono::milliseconds(1));
+        }
+
+        parked.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+public:
+    RingQueue(size_t capacity): mask(roundUpToPowerOfTwo(capacity) - 1),
+                                cells(new Cell[mask + 1]),
+                                padding0(),
+                                enqueue_position(0),
+                                padding1(),
+                                dequeue_position(0),
+                                padding2(),
+                                park_mutex(),
+                                not_empty(),
+                                not_full(),
+                                parked_consumers(0),
+                                parked_producers(0)
+    {
+        for (size_t i = 0; i <= mask; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    RingQueue(const RingQueue &other) = delete;
+    RingQueue& operator=(const RingQueue &other) = delete;
+
+    /* Note: No other thread may use the queue while it is destroyed. */
+    ~RingQueue()
+    {
+        size_t position = dequeue_position.load(std::memory_order_relaxed);
+
+        while (cells[position & mask].sequence.load(std::memory_order_acquire) == position + 1) {
+            cells[position & mask].element()->~T();
+            position++;
+        }
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+    bool tryPush(T &&element)
+    {
+        size_t position;
+
+        if (0 == claim(enqueue_position, 0, 1, position)) {
+            return false;
+        }
+
+        new (cells[position & mask].element()) T(std::move(element));
+        publish(position, 1);
+        wakeConsumers();
+        return true;
+    }
+
+    bool tryPop(T &result)
+    {
+        size_t position;
+
+        if (0 == claim(dequeue_position, 1, 1, position)) {
+            return false;
+        }
+
+        T *element = cells[position & mask].element();
+        result = std::move(*element);
+        element->~T();
+        publish(position, mask + 1);
+        wakeProducers();
+        return true;
+    }
+
+    void push(T element)
+    {
+        size_t position;
+
+        waitFor([&]{ return 0 != claim(enqueue_position, 0, 1, position); }, parked_producers, not_full);
+
+        new (cells[position & mask].element()) T(std::move(element));
+        publish(position, 1);
+        wakeConsumers();
+    }
+
+    void push(std::vector<T> &elements)
+    {
+        push_batch(elements.begin(), elements.end());
+    }
+
+    /*
+     * We return by value, same as BlockingQueue. Move only types are supported, and the result is moved
+     * straight out of its cell, so it doesn't have to be default constructible.
+     */
+    T pop()
+    {
+        size_t position;
+
+        waitFor([&]{ return 0 != claim(dequeue_position, 1, 1, position); }, parked_consumers, not_empty);
+
+        T *element = cells[position & mask].element();
+        T result(std::move(*element));
+        element->~T();
+        publish(position, mask + 1);
+        wakeProducers();
+        return result;
+    }
+
+    /* Pushes as much of the range as currently fits without blocking, and returns the amount pushed. */
+    template <class Iterator>
+    size_t try_push_batch(Iterator begin, Iterator end)
+    {
+        size_t first;
+        size_t count = claim(enqueue_position, 0, static_cast<size_t>(std::distance(begin, end)), first);
+
+        for (size_t i = 0; i < count; ++i, ++begin) {
+            new (cells[(first + i) & mask].element()) T(std::move(*begin));
+            publish(first + i, 1);
+        }
+
+        if (0 != count) {
+            wakeConsumers();
+        }
+
+        return count;
+    }
+
+    /* Pushes the whole range, claiming as many consecutive cells as possible with each CAS. */
+    template <class Iterator>
+    void push_batch(Iterator begin, Iterator end)
+    {
+        while (begin != end) {
+            size_t first;
+            size_t count = 0;
+
+            waitFor([&]{
+                        count = claim(enqueue_position, 0, static_cast<size_t>(std::distance(begin, end)), first);
+                        return 0 != count;
+                    },
+                    parked_producers,
+                    not_full);
+
+            for (size_t i = 0; i < count; ++i, ++begin) {
+                new (cells[(first + i) & mask].element()) T(std::move(*begin));
+                publish(first + i, 1);
+            }
+
+            wakeConsumers();
+        }
+    }
+
+    /*
+     * Waits until at least one element is available, and then pops up to max_count elements without blocking.
+     * The elements are appended to result, and their amount is returned.
+     */
+    size_t pop_batch(size_t max_count, std::vector<T> &result)
+    {
+        size_t first;
+        size_t count = 0;
+
+        waitFor([&]{
+                    count = claim(dequeue_position, 1, max_count, first);
+                    return 0 != count;
+                },
+                parked_consumers,
+                not_empty);
+
+        for (size_t i = 0; i < count; ++i) {
+            T *element = cells[(first + i) & mask].element();
+            result.push_back(std::move(*element));
+            element->~T();
+            publish(first + i, mask + 1);
+        }
+
+        wakeProducers();
+        return count;
+    }
+
+    /* Note: This is only a snapshot, it may already be stale when returned. */
+    bool empty() const
+    {
+        size_t position = dequeue_position.load(std::memory_order_relaxed);
+        size_t sequence = cells[position & mask].sequence.load(std::memory_order_acquire);
+
+        return sequence != position + 1;
+    }
+};
+
+#endif
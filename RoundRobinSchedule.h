@@ -0,0 +1,125 @@
+/*
+ * Author: Nadav Markus
+ * Generates the matches of the tournament in rounds, using the circle method: one player stays in place while
+ * the rest rotate around it, so within every P - 1 consecutive rounds each player meets every other player
+ * exactly once. This spreads the opponents as evenly as possible, while only keeping a counter per player.
+ * Rounds are generated until every player has played the required amount of games. A match between two players
+ * who both already have enough games is skipped, so only the players who still need games get extra ones.
+ * With an odd amount of players, a phantom player is added, and whoever is paired with it sits the round out.
+ */
+
+#ifndef __ROUND_ROBIN_SCHEDULE_H_
+#define __ROUND_ROBIN_SCHEDULE_H_
+
+#include <vector>
+#include <utility>
+#include <initializer_list>
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "PlayerRegistry.h"
+#include "WorkItem.h"
+
+class RoundRobinSchedule
+{
+private:
+    const size_t player_count;
+    const uint32_t required_games;
+    /* The amount of positions on the circle, including the phantom player. Always even. */
+    const size_t position_count;
+    size_t round;
+    /* The next pair of the current round. */
+    size_t pair;
+    uint32_t next_index;
+    /* The amount of matches scheduled for each player so far. */
+    std::vector<uint32_t> scheduled_matches;
+    /* The amount of players who still need games. Once it drops to zero, the schedule is over. */
+    size_t missing_players;
+
+    /* Returns the players that are paired in the current round. */
+    void currentPair(size_t &first, size_t &second) const
+    {
+        const size_t rotating = position_count - 1;
+
+        if (0 == pair) {
+            /* The fixed position meets the rotating position that is at the head this round. */
+            first = rotating;
+            second = round % rotating;
+        } else {
+            first = (round + pair) % rotating;
+            second = (round + rotating - pair) % rotating;
+        }
+
+        /* Alternate the sides between rounds, so no player always moves first. */
+        if (1 == round % 2) {
+            std::swap(first, second);
+        }
+    }
+
+public:
+    RoundRobinSchedule(size_t player_count, uint32_t required_games): player_count(player_count),
+                                                                      required_games(required_games),
+                                                                      position_count(player_count + (player_count % 2)),
+                                                                      round(0),
+                                                                      pair(0),
+                                                                      next_index(0),
+                                                                      scheduled_matches(player_count, 0),
+                                                                      missing_players(player_count) {}
+
+    /* The amount of matches in the whole schedule. It is generated to count them, without being kept. */
+    static size_t countMatches(size_t player_count, uint32_t required_games)
+    {
+        RoundRobinSchedule schedule(player_count, required_games);
+        WorkItem work_item;
+        size_t count = 0;
+
+        while (schedule.next(work_item)) {
+            count++;
+        }
+
+        return count;
+    }
+
+    /* Returns false once the schedule is over. Note: There must be at least two players. */
+    bool next(WorkItem &work_item)
+    {
+        while (0 != missing_players) {
+            if (position_count / 2 == pair) {
+                round++;
+                pair = 0;
+            }
+
+            size_t first, second;
+            currentPair(first, second);
+            pair++;
+
+            if (first >= player_count || second >= player_count) {
+                /* Paired with the phantom player. */
+                continue;
+            }
+
+            if (scheduled_matches[first] >= required_games && scheduled_matches[second] >= required_games) {
+                continue;
+            }
+
+            work_item = WorkItem(next_index++,
+                                 static_cast<playerIndex>(first),
+                                 static_cast<playerIndex>(second),
+                                 scheduled_matches[first],
+                                 scheduled_matches[second]);
+
+            for (size_t player: {first, second}) {
+                if (required_games == ++scheduled_matches[player]) {
+                    missing_players--;
+                }
+            }
+
+            return true;
+        }
+
+        return false;
+    }
+};
+
+#endif
@@ -0,0 +1,238 @@
+/*
+ * Author: Nadav Markus
+ * The shared memory channel between the tournament and a sandbox process hosting a player algorithm.
+ * The channel consists of two single producer single consumer rings of fixed size messages - one for requests
+ * and one for responses. While both sides are busy, a message costs a few atomic operations and no system calls.
+ * A side that waits for too long parks on a futex, and the other side only issues a wake up if someone is parked.
+ * Waiting is always bounded, so a waiting side can notice that its peer process died.
+ */
+
+#ifndef __SANDBOX_CHANNEL_H_
+#define __SANDBOX_CHANNEL_H_
+
+#include <atomic>
+#include <thread>
+#include <cstring>
+#include <algorithm>
+#include <iterator>
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "Globals.h"
+
+enum class SandboxMessageType : uint32_t
+{
+    /* Requests. Only the ones marked as such get a response. */
+    CREATE,
+    SET_SEED,
+    DESTROY,
+    GET_INITIAL_POSITIONS,  /* Responded with POSITIONS. */
+    NOTIFY_INITIAL_BOARD,
+    NOTIFY_OPPONENT_MOVE,
+    NOTIFY_FIGHT_RESULT,
+    GET_MOVE,               /* Responded with MOVE. */
+    GET_JOKER_CHANGE,       /* Responded with JOKER_CHANGE. */
+    SHUTDOWN,
+
+    /* Responses. */
+    POSITIONS,
+    MOVE,
+    JOKER_CHANGE
+};
+
+/* A piece position or a fight result, depending on the message. */
+struct SandboxEntry
+{
+    int32_t x;
+    int32_t y;
+    /* The owning player for positions and board cells, the winner for fights. */
+    int32_t player;
+    /* The piece and joker representation for positions, the pieces of player 1 and 2 for fights. */
+    char first;
+    char second;
+};
+
+struct SandboxMessage
+{
+    /* The initial board notification carries both the occupied cells and the fights. */
+    static constexpr size_t MAX_ENTRIES = 2 * Globals::M * Globals::N;
+
+    SandboxMessageType type;
+    /* The meaning of the arguments depends on the message type. */
+    int64_t arguments[5];
+    uint32_t entry_count;
+    SandboxEntry entries[MAX_ENTRIES];
+
+    /* Note: Only the header is cleared, since the entries are not copied unless they are used. */
+    void init(SandboxMessageType type)
+    {
+        this->type = type;
+        std::fill(std::begin(arguments), std::end(arguments), 0);
+        entry_count = 0;
+    }
+
+    /*
+     * Most messages carry no entries, so only the used part of a message is copied.
+     * Note: The other side may be a misbehaving player, so the entry count is never trusted blindly.
+     */
+    static void copy(SandboxMessage &destination, const SandboxMessage &source)
+    {
+        size_t entry_count = source.entry_count;
+
+        if (entry_count > MAX_ENTRIES) {
+            entry_count = MAX_ENTRIES;
+        }
+
+        size_t size = offsetof(SandboxMessage, entries) + entry_count * sizeof(SandboxEntry);
+        std::memcpy(static_cast<void*>(&destination), static_cast<const void*>(&source), size);
+        destination.entry_count = static_cast<uint32_t>(entry_count);
+    }
+};
+
+class SandboxRing
+{
+private:
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+    static constexpr uint32_t SLOT_COUNT = 8;
+    static constexpr size_t SPIN_COUNT = 256;
+    static constexpr size_t YIELD_COUNT = 64;
+    /* How often a parked side wakes up to check whether its peer is still alive. */
+    static constexpr long PARK_TIMEOUT_NS = 5 * 1000 * 1000;
+
+    /* The amount of messages pushed, and the amount popped. Both only ever grow (modulo 2^32). */
+    std::atomic<uint32_t> head;
+    char padding0[CACHE_LINE_SIZE];
+    std::atomic<uint32_t> tail;
+    char padding1[CACHE_LINE_SIZE];
+    std::atomic<uint32_t> consumer_parked;
+    std::atomic<uint32_t> producer_parked;
+    char padding2[CACHE_LINE_SIZE];
+    SandboxMessage slots[SLOT_COUNT];
+
+    /* Note: The futexes live in memory shared between processes, so the private futex operations can't be used. */
+    static void futexWait(std::atomic<uint32_t> &word, uint32_t expected)
+    {
+        struct timespec timeout;
+        timeout.tv_sec = 0;
+        timeout.tv_nsec = PARK_TIMEOUT_NS;
+        (void) syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, &timeout, nullptr, 0);
+    }
+
+    static void futexWake(std::atomic<uint32_t> &word)
+    {
+        (void) syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+    }
+
+    /*
+     * Waits until the condition holds. Once spinning didn't help, we park on the given word, which the other side
+     * changes whenever the condition may have become true. Returns false if the peer is found dead in the meantime.
+     */
+    template <class Condition, class IsPeerAlive>
+    static bool waitUntil(Condition condition,
+                          std::atomic<uint32_t> &word,
+                          std::atomic<uint32_t> &parked,
+                          IsPeerAlive is_peer_alive)
+    {
+        for (size_t i = 0; i < SPIN_COUNT + YIELD_COUNT; ++i) {
+            if (condition()) {
+                return true;
+            }
+
+            if (i >= SPIN_COUNT) {
+                std::this_thread::yield();
+            }
+        }
+
+        for (;;) {
+            uint32_t observed = word.load(std::memory_order_acquire);
+            parked.store(1, std::memory_order_seq_cst);
+
+            if (condition()) {
+                parked.store(0, std::memory_order_relaxed);
+                return true;
+            }
+
+            futexWait(word, observed);
+            parked.store(0, std::memory_order_relaxed);
+
+            if (condition()) {
+                return true;
+            }
+
+            if (!is_peer_alive()) {
+                return false;
+            }
+        }
+    }
+
+public:
+    /* Note: The ring lives in shared memory, so it is reset in place rather than constructed. */
+    void reset()
+    {
+        head.store(0);
+        tail.store(0);
+        consumer_parked.store(0);
+        producer_parked.store(0);
+    }
+
+    /* Returns false if the consumer died before there was room for the message. */
+    template <class IsPeerAlive>
+    bool push(const SandboxMessage &message, IsPeerAlive is_peer_alive)
+    {
+        uint32_t current = head.load(std::memory_order_relaxed);
+
+        if (!waitUntil([&]{ return current - tail.load(std::memory_order_acquire) < SLOT_COUNT; },
+                       tail,
+                       producer_parked,
+                       is_peer_alive)) {
+            return false;
+        }
+
+        SandboxMessage::copy(slots[current % SLOT_COUNT], message);
+        head.store(current + 1, std::memory_order_seq_cst);
+
+        if (0 != consumer_parked.load(std::memory_order_seq_cst)) {
+            futexWake(head);
+        }
+
+        return true;
+    }
+
+    /* Returns false if the producer died before sending a message. */
+    template <class IsPeerAlive>
+    bool pop(SandboxMessage &message, IsPeerAlive is_peer_alive)
+    {
+        uint32_t current = tail.load(std::memory_order_relaxed);
+
+        if (!waitUntil([&]{ return head.load(std::memory_order_acquire) != current; },
+                       head,
+                       consumer_parked,
+                       is_peer_alive)) {
+            return false;
+        }
+
+        SandboxMessage::copy(message, slots[current % SLOT_COUNT]);
+        tail.store(current + 1, std::memory_order_seq_cst);
+
+        if (0 != producer_parked.load(std::memory_order_seq_cst)) {
+            futexWake(tail);
+        }
+
+        return true;
+    }
+};
+
+/* The whole shared memory region of a single sandbox. */
+struct SandboxRegion
+{
+    SandboxRing requests;
+    SandboxRing responses;
+};
+
+#endif
@@ -0,0 +1,19 @@
+/*
+ * Author: Nadav Markus
+ * An error that gets thrown when the sandbox process hosting a player dies in the middle of a game.
+ */
+
+#ifndef __SANDBOX_ERROR_H_
+#define __SANDBOX_ERROR_H_
+
+#include "BaseError.h"
+
+#include <string>
+
+class SandboxError : public BaseError
+{
+public:
+    SandboxError(const std::string &message): BaseError(message) {}
+};
+
+#endif
@@ -0,0 +1,327 @@
+#include <memory>
+#include <vector>
+#include <iostream>
+#include <chrono>
+#include <thread>
+
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "SandboxHost.h"
+#include "SeededAlgorithm.h"
+#include "ConcreteBoard.h"
+#include "ConcreteFightInfo.h"
+#include "ConcreteMove.h"
+
+SandboxHost::SandboxHost(const PlayerRegistry &registry): registry(registry),
+                                                          region(nullptr),
+                                                          child(-1),
+                                                          hosted_player(0) {}
+
+SandboxHost::~SandboxHost()
+{
+    if (isAlive()) {
+        SandboxMessage request;
+        request.init(SandboxMessageType::SHUTDOWN);
+        (void) notify(request);
+
+        /* A child stuck inside a player won't ever read the request, so we only wait for a while. */
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+
+        while (isAlive() && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        if (isAlive()) {
+            (void) kill(child, SIGKILL);
+            (void) waitpid(child, nullptr, 0);
+        }
+    }
+
+    if (nullptr != region) {
+        (void) munmap(region, sizeof(SandboxRegion));
+    }
+}
+
+bool SandboxHost::start()
+{
+    if (nullptr == region) {
+        void *memory = mmap(nullptr, sizeof(SandboxRegion), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+        if (MAP_FAILED == memory) {
+            std::cerr << "Failed to map the shared memory of a sandbox." << std::endl;
+            return false;
+        }
+
+        region = static_cast<SandboxRegion*>(memory);
+    }
+
+    /* Whatever a previous child left in the rings is dropped. */
+    region->requests.reset();
+    region->responses.reset();
+
+    /* Otherwise, output that is still buffered would be printed by both processes. */
+    std::cout.flush();
+    std::cerr.flush();
+
+    pid_t parent = getpid();
+    pid_t pid = fork();
+
+    if (-1 == pid) {
+        std::cerr << "Failed to fork a sandbox." << std::endl;
+        return false;
+    }
+
+    if (0 == pid) {
+        /* The child must not outlive the tournament, even if the tournament itself crashes. */
+        (void) prctl(PR_SET_PDEATHSIG, SIGKILL);
+
+        if (getppid() == parent) {
+            serve();
+        }
+
+        std::cout.flush();
+        _exit(0);
+    }
+
+    child = pid;
+    return true;
+}
+
+bool SandboxHost::isAlive()
+{
+    if (-1 == child) {
+        return false;
+    }
+
+    if (0 == waitpid(child, nullptr, WNOHANG)) {
+        return true;
+    }
+
+    child = -1;
+    return false;
+}
+
+bool SandboxHost::notify(const SandboxMessage &request)
+{
+    return region->requests.push(request, [this]{ return isAlive(); });
+}
+
+bool SandboxHost::call(const SandboxMessage &request, SandboxMessage &response)
+{
+    return notify(request) && region->responses.pop(response, [this]{ return isAlive(); });
+}
+
+bool SandboxHost::create(playerIndex player)
+{
+    SandboxMessage request;
+    request.init(SandboxMessageType::CREATE);
+    request.arguments[0] = player;
+
+    hosted_player = player;
+    return notify(request);
+}
+
+/* The child's main loop. It returns once asked to shut down, or once the tournament is gone. */
+void SandboxHost::serve()
+{
+    pid_t parent = getppid();
+    auto is_parent_alive = [parent]{ return getppid() == parent; };
+
+    std::unique_ptr<PlayerAlgorithm> algorithm;
+    SandboxMessage request;
+
+    while (region->requests.pop(request, is_parent_alive)) {
+        if (SandboxMessageType::SHUTDOWN == request.type) {
+            break;
+        }
+
+        handleRequest(algorithm, request);
+    }
+}
+
+void SandboxHost::reply(const SandboxMessage &response)
+{
+    pid_t parent = getppid();
+
+    if (!region->responses.push(response, [parent]{ return getppid() == parent; })) {
+        /* Nobody is waiting for us anymore. */
+        _exit(0);
+    }
+}
+
+/*
+ * Note: A request that expects a response always gets one, even if there is no algorithm to serve it.
+ * An empty response is treated as a bad move by the tournament.
+ */
+void SandboxHost::handleRequest(std::unique_ptr<PlayerAlgorithm> &algorithm, const SandboxMessage &request)
+{
+    SandboxMessage response;
+
+    switch (request.type) {
+        case SandboxMessageType::CREATE:
+        {
+            /* The old player must be gone before the new one is created, same as without a sandbox. */
+            algorithm = nullptr;
+
+            if (request.arguments[0] >= 0 && static_cast<size_t>(request.arguments[0]) < registry.size()) {
+                algorithm = registry.createAlgorithm(static_cast<playerIndex>(request.arguments[0]));
+            }
+
+            break;
+        }
+
+        case SandboxMessageType::SET_SEED:
+        {
+            SeededAlgorithm *seeded = dynamic_cast<SeededAlgorithm*>(algorithm.get());
+
+            if (nullptr != seeded) {
+                seeded->setSeed(static_cast<uint64_t>(request.arguments[0]));
+            }
+
+            break;
+        }
+
+        case SandboxMessageType::DESTROY:
+            algorithm = nullptr;
+            break;
+
+        case SandboxMessageType::GET_INITIAL_POSITIONS:
+        {
+            std::vector<unique_ptr<PiecePosition>> positions;
+
+            if (nullptr != algorithm) {
+                algorithm->getInitialPositions(static_cast<int>(request.arguments[0]), positions);
+            }
+
+            response.init(SandboxMessageType::POSITIONS);
+            /* More positions than can be sent surely means that the positions are invalid. */
+            response.arguments[0] = (positions.size() > SandboxMessage::MAX_ENTRIES);
+
+            for (const auto &position: positions) {
+                if (response.entry_count == SandboxMessage::MAX_ENTRIES) {
+                    break;
+                }
+
+                SandboxEntry &entry = response.entries[response.entry_count++];
+                entry.x = position->getPosition().getX();
+                entry.y = position->getPosition().getY();
+                entry.player = static_cast<int32_t>(request.arguments[0]);
+                entry.first = position->getPiece();
+                entry.second = position->getJokerRep();
+            }
+
+            reply(response);
+            break;
+        }
+
+        case SandboxMessageType::NOTIFY_INITIAL_BOARD:
+        {
+            /* The first entries are the occupied cells, and the rest are the fights. */
+            ConcreteBoard board;
+            std::vector<unique_ptr<FightInfo>> fights;
+            size_t cell_count = std::min<size_t>(static_cast<size_t>(request.arguments[0]), request.entry_count);
+
+            for (size_t i = 0; i < request.entry_count; ++i) {
+                const SandboxEntry &entry = request.entries[i];
+
+                if (i < cell_count) {
+                    board.addPosition(ConcretePiecePosition(entry.player, entry.x, entry.y, '#'));
+                } else {
+                    fights.push_back(std::make_unique<ConcreteFightInfo>(entry.player,
+                                                                         entry.first,
+                                                                         entry.second,
+                                                                         entry.x,
+                                                                         entry.y));
+                }
+            }
+
+            if (nullptr != algorithm) {
+                algorithm->notifyOnInitialBoard(board, fights);
+            }
+
+            break;
+        }
+
+        case SandboxMessageType::NOTIFY_OPPONENT_MOVE:
+        {
+            ConcreteMove move(static_cast<int>(request.arguments[0]),
+                              static_cast<int>(request.arguments[1]),
+                              static_cast<int>(request.arguments[2]),
+                              static_cast<int>(request.arguments[3]));
+
+            if (nullptr != algorithm) {
+                algorithm->notifyOnOpponentMove(move);
+            }
+
+            break;
+        }
+
+        case SandboxMessageType::NOTIFY_FIGHT_RESULT:
+        {
+            if (0 == request.entry_count) {
+                break;
+            }
+
+            const SandboxEntry &entry = request.entries[0];
+            ConcreteFightInfo fight(entry.player, entry.first, entry.second, entry.x, entry.y);
+
+            if (nullptr != algorithm) {
+                algorithm->notifyFightResult(fight);
+            }
+
+            break;
+        }
+
+        case SandboxMessageType::GET_MOVE:
+        {
+            unique_ptr<Move> move;
+
+            if (nullptr != algorithm) {
+                move = algorithm->getMove();
+            }
+
+            response.init(SandboxMessageType::MOVE);
+            response.arguments[0] = (nullptr != move);
+
+            if (nullptr != move) {
+                response.arguments[1] = move->getFrom().getX();
+                response.arguments[2] = move->getFrom().getY();
+                response.arguments[3] = move->getTo().getX();
+                response.arguments[4] = move->getTo().getY();
+            }
+
+            reply(response);
+            break;
+        }
+
+        case SandboxMessageType::GET_JOKER_CHANGE:
+        {
+            unique_ptr<JokerChange> joker_change;
+
+            if (nullptr != algorithm) {
+                joker_change = algorithm->getJokerChange();
+            }
+
+            response.init(SandboxMessageType::JOKER_CHANGE);
+            response.arguments[0] = (nullptr != joker_change);
+
+            if (nullptr != joker_change) {
+                response.arguments[1] = joker_change->getJokerChangePosition().getX();
+                response.arguments[2] = joker_change->getJokerChangePosition().getY();
+                response.arguments[3] = joker_change->getJokerNewRep();
+            }
+
+            reply(response);
+            break;
+        }
+
+        default:
+            /* Responses and shutdown requests are never handled here. */
+            break;
+    }
+}
@@ -0,0 +1,70 @@
+/*
+ * Author: Nadav Markus
+ * A persistent child process that hosts player algorithms on behalf of a single worker thread.
+ * The child is forked once and then serves one algorithm after the other, so isolating the players costs
+ * a few shared memory round trips per move, rather than a fork per match. If a player crashes its host,
+ * only the current game is lost, and the host is forked again before the next one.
+ */
+
+#ifndef __SANDBOX_HOST_H_
+#define __SANDBOX_HOST_H_
+
+#include <memory>
+
+#include <stdlib.h>
+#include <sys/types.h>
+
+#include "PlayerAlgorithm.h"
+#include "PlayerRegistry.h"
+#include "SandboxChannel.h"
+
+/* How the players are isolated from the tournament. */
+enum class IsolationMode
+{
+    /* The players run inside the tournament process. */
+    NONE,
+    /* The players run inside persistent sandbox processes, one per worker and side. */
+    PROCESS
+};
+
+class SandboxHost
+{
+private:
+    /* Note: The registry must be frozen before the host is started, and outlive it. */
+    const PlayerRegistry &registry;
+    SandboxRegion *region;
+    pid_t child;
+    /* The player that was last created in the child, so a crash can be attributed to it. */
+    playerIndex hosted_player;
+
+    /* Only ever called inside the child. */
+    void serve();
+    void handleRequest(std::unique_ptr<PlayerAlgorithm> &algorithm, const SandboxMessage &request);
+    void reply(const SandboxMessage &response);
+
+public:
+    SandboxHost(const PlayerRegistry &registry);
+    SandboxHost(const SandboxHost &other) = delete;
+    SandboxHost& operator=(const SandboxHost &other) = delete;
+    /* Asks the child to exit, and waits for it. */
+    ~SandboxHost();
+
+    /* Forks the child. Returns false if the shared memory could not be mapped, or the fork failed. */
+    bool start();
+
+    /* Returns false if the child died. The child is reaped as soon as it is found dead. */
+    bool isAlive();
+
+    playerIndex getHostedPlayer() const { return hosted_player; }
+
+    /* Sends a request without waiting for it. Returns false if the child is dead. */
+    bool notify(const SandboxMessage &request);
+
+    /* Sends a request and waits for its response. Returns false if the child died before responding. */
+    bool call(const SandboxMessage &request, SandboxMessage &response);
+
+    /* Creates the given player in the child, instead of the current one. */
+    bool create(playerIndex player);
+};
+
+#endif
@@ -0,0 +1,188 @@
+/*
+ * Author: Nadav Markus
+ * A player algorithm that forwards every call to a player hosted inside a SandboxHost.
+ * Notifications are sent without waiting for the child to handle them, so only the calls that return
+ * something cost a round trip. If the child dies, the next call that expects a response throws, so the
+ * game is lost by the player that crashed rather than by whichever player happens to be notified.
+ */
+
+#ifndef __SANDBOXED_PLAYER_ALGORITHM_H_
+#define __SANDBOXED_PLAYER_ALGORITHM_H_
+
+#include <vector>
+#include <memory>
+
+#include "PlayerAlgorithm.h"
+#include "SeededAlgorithm.h"
+#include "PlayerRegistry.h"
+#include "SandboxHost.h"
+#include "SandboxChannel.h"
+#include "SandboxError.h"
+#include "PositionError.h"
+#include "BadMoveError.h"
+#include "Globals.h"
+#include "ConcretePoint.h"
+#include "ConcretePiecePosition.h"
+#include "ConcreteMove.h"
+#include "ConcreteJokerChange.h"
+
+class SandboxedPlayerAlgorithm : public PlayerAlgorithm, public SeededAlgorithm
+{
+private:
+    SandboxHost &host;
+    /* Reused for every call. A message is a few kilobytes, and only its used part is ever copied. */
+    SandboxMessage request;
+    SandboxMessage response;
+
+    void notify()
+    {
+        /* Note: A dead child is detected by the next call that expects a response. */
+        (void) host.notify(request);
+    }
+
+    void call(SandboxMessageType response_type)
+    {
+        if (!host.call(request, response)) {
+            throw SandboxError("The sandbox hosting the player crashed");
+        }
+
+        if (response_type != response.type) {
+            throw SandboxError("The sandbox hosting the player sent an unexpected response");
+        }
+    }
+
+public:
+    SandboxedPlayerAlgorithm(SandboxHost &host, playerIndex player): host(host)
+    {
+        (void) host.create(player);
+    }
+
+    SandboxedPlayerAlgorithm(const SandboxedPlayerAlgorithm &other) = delete;
+    SandboxedPlayerAlgorithm& operator=(const SandboxedPlayerAlgorithm &other) = delete;
+
+    virtual ~SandboxedPlayerAlgorithm()
+    {
+        request.init(SandboxMessageType::DESTROY);
+        notify();
+    }
+
+    /* The hosted player is only seeded if it is seeded itself. */
+    virtual void setSeed(uint64_t seed) override
+    {
+        request.init(SandboxMessageType::SET_SEED);
+        request.arguments[0] = static_cast<int64_t>(seed);
+        notify();
+    }
+
+    virtual void getInitialPositions(int player, std::vector<unique_ptr<PiecePosition>> &vectorToFill) override
+    {
+        request.init(SandboxMessageType::GET_INITIAL_POSITIONS);
+        request.arguments[0] = player;
+        call(SandboxMessageType::POSITIONS);
+
+        if (0 != response.arguments[0]) {
+            throw PositionError("The player returned more positions than there are cells on the board");
+        }
+
+        for (size_t i = 0; i < response.entry_count; ++i) {
+            const SandboxEntry &entry = response.entries[i];
+            vectorToFill.push_back(std::make_unique<ConcretePiecePosition>(player,
+                                                                           entry.x,
+                                                                           entry.y,
+                                                                           entry.first,
+                                                                           entry.second));
+        }
+    }
+
+    virtual void notifyOnInitialBoard(const Board &b, const std::vector<unique_ptr<FightInfo>> &fights) override
+    {
+        request.init(SandboxMessageType::NOTIFY_INITIAL_BOARD);
+
+        for (size_t y = 1; y <= Globals::N; ++y) {
+            for (size_t x = 1; x <= Globals::M; ++x) {
+                int owner = b.getPlayer(ConcretePoint(static_cast<int>(x), static_cast<int>(y)));
+
+                if (0 != owner) {
+                    SandboxEntry &entry = request.entries[request.entry_count++];
+                    entry.x = static_cast<int32_t>(x);
+                    entry.y = static_cast<int32_t>(y);
+                    entry.player = owner;
+                    entry.first = '#';
+                    entry.second = '#';
+                }
+            }
+        }
+
+        request.arguments[0] = request.entry_count;
+
+        /* There is at most a single fight per cell. */
+        for (const auto &fight: fights) {
+            if (SandboxMessage::MAX_ENTRIES == request.entry_count) {
+                break;
+            }
+
+            SandboxEntry &entry = request.entries[request.entry_count++];
+            entry.x = fight->getPosition().getX();
+            entry.y = fight->getPosition().getY();
+            entry.player = fight->getWinner();
+            entry.first = fight->getPiece(1);
+            entry.second = fight->getPiece(2);
+        }
+
+        notify();
+    }
+
+    virtual void notifyOnOpponentMove(const Move &move) override
+    {
+        request.init(SandboxMessageType::NOTIFY_OPPONENT_MOVE);
+        request.arguments[0] = move.getFrom().getX();
+        request.arguments[1] = move.getFrom().getY();
+        request.arguments[2] = move.getTo().getX();
+        request.arguments[3] = move.getTo().getY();
+        notify();
+    }
+
+    virtual void notifyFightResult(const FightInfo &fightInfo) override
+    {
+        request.init(SandboxMessageType::NOTIFY_FIGHT_RESULT);
+
+        SandboxEntry &entry = request.entries[request.entry_count++];
+        entry.x = fightInfo.getPosition().getX();
+        entry.y = fightInfo.getPosition().getY();
+        entry.player = fightInfo.getWinner();
+        entry.first = fightInfo.getPiece(1);
+        entry.second = fightInfo.getPiece(2);
+        notify();
+    }
+
+    virtual unique_ptr<Move> getMove() override
+    {
+        request.init(SandboxMessageType::GET_MOVE);
+        call(SandboxMessageType::MOVE);
+
+        if (0 == response.arguments[0]) {
+            throw BadMoveError("The player returned no move");
+        }
+
+        return std::make_unique<ConcreteMove>(static_cast<int>(response.arguments[1]),
+                                              static_cast<int>(response.arguments[2]),
+                                              static_cast<int>(response.arguments[3]),
+                                              static_cast<int>(response.arguments[4]));
+    }
+
+    virtual unique_ptr<JokerChange> getJokerChange() override
+    {
+        request.init(SandboxMessageType::GET_JOKER_CHANGE);
+        call(SandboxMessageType::JOKER_CHANGE);
+
+        if (0 == response.arguments[0]) {
+            return nullptr;
+        }
+
+        return std::make_unique<ConcreteJokerChange>(static_cast<int>(response.arguments[1]),
+                                                     static_cast<int>(response.arguments[2]),
+                                                     static_cast<char>(response.arguments[3]));
+    }
+};
+
+#endif
@@ -0,0 +1,28 @@
+/*
+ * Author: Nadav Markus
+ * Counter based seeds: a seed is the splitmix64 finalizer of a key and a counter, so a stream of seeds needs
+ * nothing but its key and the amount of seeds drawn from it, and neighbouring keys give unrelated streams.
+ */
+
+#ifndef __SEED_STREAMS_H_
+#define __SEED_STREAMS_H_
+
+#include <stdint.h>
+
+namespace SeedStreams
+{
+    inline uint64_t mix(uint64_t value)
+    {
+        value += 0x9e3779b97f4a7c15ULL;
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+        return value ^ (value >> 31);
+    }
+    
+    inline uint64_t seedAt(uint64_t key, uint64_t counter)
+    {
+        return mix(mix(key) + counter);
+    }
+}
+
+#endif
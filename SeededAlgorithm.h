@@ -0,0 +1,20 @@
+/*
+ * Author: Nadav Markus
+ * An optional interface for player algorithms that make random choices. An algorithm that implements it
+ * gets a seed derived from the tournament's master seed and the match, right after it is created and before
+ * any other call, so every match can be replayed exactly. Algorithms that don't implement it are left alone.
+ */
+
+#ifndef __SEEDED_ALGORITHM_H_
+#define __SEEDED_ALGORITHM_H_
+
+#include <stdint.h>
+
+class SeededAlgorithm
+{
+public:
+    virtual void setSeed(uint64_t seed) = 0;
+    virtual ~SeededAlgorithm() {}
+};
+
+#endif
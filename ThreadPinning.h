@@ -0,0 +1,143 @@
+/*
+ * Author: Nadav Markus
+ * Utilities to pin the tournament's worker threads to cores.
+ * Compact pinning fills one package at a time (hyper threads of a core next to each other), so the workers
+ * share caches. Scatter pinning spreads the workers across packages first and cores second, so each worker
+ * gets as much cache and memory bandwidth as possible.
+ */
+
+#ifndef __THREAD_PINNING_H_
+#define __THREAD_PINNING_H_
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <tuple>
+#include <map>
+
+#include <sched.h>
+
+enum class PinningPolicy
+{
+    NONE,
+    COMPACT,
+    SCATTER
+};
+
+namespace ThreadPinning
+{
+    /* Returns -1 if the value is not available (for example, sysfs is not mounted). */
+    inline int readTopologyValue(int cpu, const std::string &name)
+    {
+        std::ifstream topology_file("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/" + name);
+        int value = -1;
+
+        if (!(topology_file >> value)) {
+            return -1;
+        }
+
+        return value;
+    }
+
+    /*
+     * Returns the cpus the process may run on, in the order in which workers should be pinned to them.
+     * An empty vector is returned if pinning is disabled or the affinity mask can't be retrieved.
+     */
+    inline std::vector<int> getPinningOrder(PinningPolicy policy)
+    {
+        std::vector<int> order;
+
+        if (PinningPolicy::NONE == policy) {
+            return order;
+        }
+
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+
+        if (0 != sched_getaffinity(0, sizeof(allowed), &allowed)) {
+            return order;
+        }
+
+        /* (package, core, rank of the hyper thread within the core, cpu) */
+        std::vector<std::tuple<int, int, int, int>> cpus;
+
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (!CPU_ISSET(cpu, &allowed)) {
+                continue;
+            }
+
+            int package = readTopologyValue(cpu, "physical_package_id");
+            int core = readTopologyValue(cpu, "core_id");
+
+            /* Without topology information, every cpu is considered to be a separate core. */
+            if (-1 == core) {
+                core = cpu;
+            }
+
+            int sibling_rank = 0;
+            for (const auto &other: cpus) {
+                if (std::get<0>(other) == package && std::get<1>(other) == core) {
+                    sibling_rank++;
+                }
+            }
+
+            cpus.push_back(std::make_tuple(package, core, sibling_rank, cpu));
+        }
+
+        if (PinningPolicy::COMPACT == policy) {
+            std::sort(cpus.begin(), cpus.end());
+
+        } else {
+            /* Scatter: the first hyper thread of every core comes before any second one, alternating packages. */
+            std::map<int, std::vector<int>> package_to_cores;
+            std::vector<std::tuple<int, int, int, int>> ranked;
+
+            std::sort(cpus.begin(), cpus.end());
+
+            for (const auto &entry: cpus) {
+                std::vector<int> &cores = package_to_cores[std::get<0>(entry)];
+
+                if (cores.empty() || cores.back() != std::get<1>(entry)) {
+                    cores.push_back(std::get<1>(entry));
+                }
+
+                /* (rank of the hyper thread, rank of the core within its package, package, cpu) */
+                int core_rank = static_cast<int>(cores.size()) - 1;
+                ranked.push_back(std::make_tuple(std::get<2>(entry), core_rank, std::get<0>(entry), std::get<3>(entry)));
+            }
+
+            std::sort(ranked.begin(), ranked.end());
+            cpus = ranked;
+        }
+
+        for (const auto &entry: cpus) {
+            order.push_back(std::get<3>(entry));
+        }
+
+        return order;
+    }
+
+    inline bool getCurrentAffinity(cpu_set_t &mask)
+    {
+        CPU_ZERO(&mask);
+        return 0 == sched_getaffinity(0, sizeof(mask), &mask);
+    }
+
+    inline bool setCurrentAffinity(const cpu_set_t &mask)
+    {
+        return 0 == sched_setaffinity(0, sizeof(mask), &mask);
+    }
+
+    inline bool pinCurrentThread(int cpu)
+    {
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        CPU_SET(cpu, &mask);
+
+        /* On Linux, a pid of 0 refers to the calling thread rather than to the whole process. */
+        return 0 == sched_setaffinity(0, sizeof(mask), &mask);
+    }
+}
+
+#endif
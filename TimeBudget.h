@@ -0,0 +1,218 @@
+/*
+ * Author: Nadav Markus
+ * Time budgets for calls into the player algorithms.
+ * The game measures every call with a monotonic clock and reacts to overruns once the call returns,
+ * according to the policy. Since a call that never returns can't be measured this way, every worker also
+ * publishes the call it is currently in to a watchdog thread, which flags calls that run past their budget.
+ */
+
+#ifndef __TIME_BUDGET_H_
+#define __TIME_BUDGET_H_
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+#include <memory>
+
+#include <stdlib.h>
+#include <stdint.h>
+
+enum class OverrunPolicy
+{
+    /* The overrunning player loses the game. */
+    FORFEIT,
+    /* The overrun is only counted and reported. */
+    WARN
+};
+
+struct TimeBudget
+{
+    std::chrono::nanoseconds positions_budget;
+    std::chrono::nanoseconds move_budget;
+    OverrunPolicy policy;
+
+    TimeBudget(std::chrono::nanoseconds positions_budget,
+               std::chrono::nanoseconds move_budget,
+               OverrunPolicy policy): positions_budget(positions_budget),
+                                      move_budget(move_budget),
+                                      policy(policy) {}
+};
+
+/* The call a single worker is currently in. Written by the worker, read by the watchdog. */
+struct WatchdogSlot
+{
+private:
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+public:
+    /* The time the current call started, in steady clock nanoseconds, or 0 if the worker is not in a call. */
+    std::atomic<int64_t> call_start;
+    std::atomic<int64_t> call_budget;
+    /* 1 or 2, according to the player that was called. */
+    std::atomic<int> calling_player;
+    /* Set by the watchdog once it reported the current call, so every call is reported at most once. */
+    std::atomic<bool> flagged;
+    /* The indices of the players in the current match, so the watchdog can tell who overran. */
+    std::atomic<uint32_t> player1;
+    std::atomic<uint32_t> player2;
+    char padding[CACHE_LINE_SIZE];
+
+    WatchdogSlot(): call_start(0),
+                    call_budget(0),
+                    calling_player(0),
+                    flagged(false),
+                    player1(0),
+                    player2(0),
+                    padding() {}
+
+    void setPlayers(uint32_t player1, uint32_t player2)
+    {
+        this->player1.store(player1, std::memory_order_relaxed);
+        this->player2.store(player2, std::memory_order_relaxed);
+    }
+
+    uint32_t getPlayer(int player) const
+    {
+        return (1 == player) ? player1.load(std::memory_order_relaxed) : player2.load(std::memory_order_relaxed);
+    }
+
+    static int64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void enter(int player, std::chrono::nanoseconds budget)
+    {
+        calling_player.store(player, std::memory_order_relaxed);
+        call_budget.store(budget.count(), std::memory_order_relaxed);
+        flagged.store(false, std::memory_order_relaxed);
+        call_start.store(now(), std::memory_order_release);
+    }
+
+    void leave()
+    {
+        call_start.store(0, std::memory_order_release);
+    }
+};
+
+/* Publishes a call to the slot for as long as it lives, so the slot is left even if the call throws. */
+class WatchdogCall
+{
+private:
+    /* Optional. */
+    WatchdogSlot *slot;
+
+public:
+    WatchdogCall(WatchdogSlot *slot, int player, std::chrono::nanoseconds budget): slot(slot)
+    {
+        if (nullptr != slot) {
+            slot->enter(player, budget);
+        }
+    }
+
+    WatchdogCall(const WatchdogCall &other) = delete;
+    WatchdogCall& operator=(const WatchdogCall &other) = delete;
+
+    ~WatchdogCall()
+    {
+        if (nullptr != slot) {
+            slot->leave();
+        }
+    }
+};
+
+class Watchdog
+{
+public:
+    /*
+     * Invoked from the watchdog thread with the worker index, the index of the player that was called and how
+     * long the call is running.
+     */
+    using overrunCallback = std::function<void(size_t, uint32_t, std::chrono::nanoseconds)>;
+
+private:
+    std::vector<std::unique_ptr<WatchdogSlot>> slots;
+    std::chrono::nanoseconds interval;
+    overrunCallback callback;
+    std::atomic<size_t> flagged_calls;
+    std::mutex stop_mutex;
+    std::condition_variable stop_condition;
+    bool should_stop;
+    std::thread thread;
+
+    void scan()
+    {
+        int64_t now = WatchdogSlot::now();
+
+        for (size_t i = 0; i < slots.size(); ++i) {
+            WatchdogSlot &slot = *slots[i];
+            int64_t start = slot.call_start.load(std::memory_order_acquire);
+
+            if (0 == start || slot.flagged.load(std::memory_order_relaxed)) {
+                continue;
+            }
+
+            int64_t running = now - start;
+
+            if (running > slot.call_budget.load(std::memory_order_relaxed)) {
+                slot.flagged.store(true, std::memory_order_relaxed);
+                flagged_calls++;
+                callback(i,
+                         slot.getPlayer(slot.calling_player.load(std::memory_order_relaxed)),
+                         std::chrono::nanoseconds(running));
+            }
+        }
+    }
+
+    void watch()
+    {
+        std::unique_lock<std::mutex> lock(stop_mutex);
+
+        while (!should_stop) {
+            stop_condition.wait_for(lock, interval);
+            scan();
+        }
+    }
+
+public:
+    /* The watchdog checks the slots every interval. Half of the smallest budget is a reasonable choice. */
+    Watchdog(size_t worker_count,
+             std::chrono::nanoseconds interval,
+             overrunCallback callback): slots(),
+                                        interval(interval),
+                                        callback(callback),
+                                        flagged_calls(0),
+                                        stop_mutex(),
+                                        stop_condition(),
+                                        should_stop(false),
+                                        thread()
+    {
+        for (size_t i = 0; i < worker_count; ++i) {
+            slots.push_back(std::make_unique<WatchdogSlot>());
+        }
+
+        thread = std::thread(&Watchdog::watch, this);
+    }
+
+    ~Watchdog()
+    {
+        {
+            std::lock_guard<std::mutex> lock(stop_mutex);
+            should_stop = true;
+        }
+
+        stop_condition.notify_one();
+        thread.join();
+    }
+
+    WatchdogSlot& getSlot(size_t worker_index) { return *slots[worker_index]; }
+
+    size_t getFlaggedCalls() const { return flagged_calls.load(); }
+};
+
+#endif
@@ -0,0 +1,19 @@
+/*
+ * Author: Nadav Markus
+ * An error that gets thrown when a player exceeds its time budget, and the policy is to forfeit the game.
+ */
+
+#ifndef __TIMEOUT_ERROR_H_
+#define __TIMEOUT_ERROR_H_
+
+#include "BaseError.h"
+
+#include <string>
+
+class TimeoutError : public BaseError
+{
+public:
+    TimeoutError(const std::string &message): BaseError(message) {}
+};
+
+#endif
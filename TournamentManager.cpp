@@ -9,24 +9,36 @@
 #include <limits>
 #include <algorithm>
 #include <iterator>
+#include <chrono>
+#include <sstream>
 
 /* Note: I don't use the filesystem header because it exists only from c++17 onwards. */
 #include <dirent.h>
 #include <sys/stat.h>
 #include <dlfcn.h>
 #include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
 
 #include "TournamentManager.h"
 #include "Game.h"
 #include "PlayerAlgorithm.h"
+#include "SandboxedPlayerAlgorithm.h"
+#include "SeededAlgorithm.h"
+#include "SeedStreams.h"
 
-void TournamentManager::loadAllPlayers()
+const char * const TournamentManager::BUILTIN_PLAYER_ID = "305261901";
+
+/* Returns the names of all the files in the so directory that look like players. */
+std::vector<std::string> TournamentManager::findPlayerFiles() const
 {
+    std::vector<std::string> names;
     DIR *raw_so_dir = opendir(so_directory.c_str());
     
     if (nullptr == raw_so_dir) {
         std::cerr << "Failed to retrieve dir entries from the so dir." << std::endl;
-        return;
+        return names;
     }
     
     struct dirent *dir_entry;
@@ -47,41 +59,148 @@ void TournamentManager::loadAllPlayers()
                 /* This is not another player's lib. */
                 continue;
             }
-            void *algorithm_so = dlopen((so_directory + name).c_str(), RTLD_NOW);
             
-            if (nullptr == algorithm_so) {
-                std::cerr << "Failed to load player from " << name << std::endl;
-                std::cout << dlerror() << std::endl;
-            }
+            names.push_back(name);
         }
     }
     
     (void) closedir(raw_so_dir);
+    
+    /* We report in a stable order, regardless of the order of the dir entries. */
+    std::sort(names.begin(), names.end());
+    return names;
 }
 
-/* Note: The caller is responsible for locking. */
-void TournamentManager::incrementIfNeeded(const std::string &id, size_t how_much)
+/*
+ * Loads a single player. This runs on the loader threads, and the registration of the player happens
+ * from within dlopen, when the shared object's constructor runs. The registry serializes the registrations.
+ * Note: The dynamic loader itself serializes dlopen calls, so we first ask the kernel to read the file in.
+ * This way, the disk reads of the different players overlap, and only the relocation work is serialized.
+ */
+void TournamentManager::loadPlayer(PluginLoadResult &result) const
 {
-    if (id_to_play_count[id] < TournamentManager::REQUIRED_GAMES) {
-        id_to_points[id] += how_much;
+    std::string path = so_directory + result.name;
+    auto start = std::chrono::steady_clock::now();
+    
+    int fd = open(path.c_str(), O_RDONLY);
+    
+    if (-1 != fd) {
+        (void) posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+        (void) close(fd);
+    }
+    
+    auto prefetched = std::chrono::steady_clock::now();
+    void *algorithm_so = dlopen(path.c_str(), RTLD_NOW);
+    
+    if (nullptr == algorithm_so) {
+        /* Note: dlerror is thread local, so this is the error of our own dlopen. */
+        const char *error = dlerror();
+        result.error = (nullptr != error) ? error : "Unknown error";
     }
+    
+    result.loaded = (nullptr != algorithm_so);
+    std::chrono::duration<double> prefetch_elapsed = prefetched - start;
+    std::chrono::duration<double> open_elapsed = std::chrono::steady_clock::now() - prefetched;
+    result.prefetch_seconds = prefetch_elapsed.count();
+    result.open_seconds = open_elapsed.count();
 }
 
-/* Note: The caller is responsible for locking. */
-void TournamentManager::updateWithItemResults(const WorkItem &work_item, int winner)
+void TournamentManager::loadAllPlayers()
+{
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::string> names = findPlayerFiles();
+    std::vector<PluginLoadResult> results;
+    
+    for (const auto &name: names) {
+        results.push_back(PluginLoadResult(name));
+    }
+    
+    /* The loader threads claim the players one by one. */
+    ChunkDispenser dispenser(results.size(), thread_count, ChunkPolicy::fixedPolicy(1));
+    auto loader = [this, &dispenser, &results] {
+        size_t begin, end;
+        
+        while (dispenser.claim(begin, end)) {
+            for (size_t i = begin; i < end; ++i) {
+                loadPlayer(results[i]);
+            }
+        }
+    };
+    
+    std::vector<std::thread> threads;
+    
+    for (size_t i = 1; i < std::min(thread_count, results.size()); ++i) {
+        threads.push_back(std::thread(loader));
+    }
+    
+    loader();
+    
+    for (auto &thread: threads) {
+        thread.join();
+    }
+    
+    /*
+     * The built-in player is created by the executable rather than by its shared object, so it is known to be
+     * a BuiltinPlayer, and its matches may be played by the games that are specialized for it.
+     */
+    bool is_builtin_loaded = registry.replaceAlgorithm(BUILTIN_PLAYER_ID, []{
+        return std::make_unique<BuiltinPlayer>();
+    });
+    
+    /* From here on the workers may look players up concurrently, so no more players can be added. */
+    registry.freeze();
+    has_builtin_player = is_builtin_loaded && registry.findIndex(BUILTIN_PLAYER_ID, builtin_player);
+    
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    
+    for (const auto &result: results) {
+        if (result.loaded) {
+            std::cout << "Loaded " << result.name << ": " << (result.prefetch_seconds * 1000) << " ms prefetching, "
+                      << (result.open_seconds * 1000) << " ms in dlopen (wall time, including waiting for other loads)"
+                      << std::endl;
+        } else {
+            std::cerr << "Failed to load player from " << result.name << std::endl;
+            std::cout << result.error << std::endl;
+        }
+    }
+    
+    std::cout << "Loaded " << registry.size() << " players from " << results.size() << " files in "
+              << elapsed.count() << " seconds" << std::endl;
+}
+
+void TournamentManager::onPlayerRegistration(std::string &id, playerAlgorithmPtr algorithm)
+{
+    if (!registry.registerPlayer(id, algorithm)) {
+        std::cerr << "Rejected the registration of " << id << " - the players were already loaded." << std::endl;
+    }
+}
+
+/*
+ * Note: The shard is owned by the calling thread, so no locking is needed.
+ * We decide by the game number rather than by the current play count, so the result does not depend on the
+ * order in which matches finish - it is the same as running the schedule in order on a single thread.
+ */
+void TournamentManager::incrementIfNeeded(ScoreShard &shard, playerIndex player, size_t game_number, size_t how_much)
+{
+    if (game_number < TournamentManager::REQUIRED_GAMES) {
+        ScoreShard::add(shard.player_points[player], how_much);
+    }
+}
+
+void TournamentManager::updateWithItemResults(ScoreShard &shard, const WorkItem &work_item, int winner)
 {
     switch(winner) {
         case 0:
-            incrementIfNeeded(work_item.player1_id, 1);
-            incrementIfNeeded(work_item.player2_id, 1);
+            incrementIfNeeded(shard, work_item.player1, work_item.player1_game_number, 1);
+            incrementIfNeeded(shard, work_item.player2, work_item.player2_game_number, 1);
             break;
         
         case 1:
-            incrementIfNeeded(work_item.player1_id, 3);
+            incrementIfNeeded(shard, work_item.player1, work_item.player1_game_number, 3);
             break;
             
         case 2:
-            incrementIfNeeded(work_item.player2_id, 3);
+            incrementIfNeeded(shard, work_item.player2, work_item.player2_game_number, 3);
             break;
             
         default:
@@ -89,106 +208,821 @@ void TournamentManager::updateWithItemResults(const WorkItem &work_item, int win
             assert(false);
     }
     
-    id_to_play_count[work_item.player1_id]++;
-    id_to_play_count[work_item.player2_id]++;
+    ScoreShard::add(shard.player_play_count[work_item.player1], 1);
+    ScoreShard::add(shard.player_play_count[work_item.player2], 1);
 }
 
-void TournamentManager::workerThread()
+void TournamentManager::createScoreShards(size_t count)
 {
-    for (;;) {
-        const WorkItem &work_item = work_queue.pop();
+    score_shards.clear();
+    
+    for (size_t i = 0; i < count; ++i) {
+        score_shards.push_back(std::make_unique<ScoreShard>(registry.size()));
+    }
+}
+
+/* Note: This must only be called after all the workers are done. */
+void TournamentManager::mergeScoreShards()
+{
+    player_points.assign(registry.size(), 0);
+    player_play_count.assign(registry.size(), 0);
+    player_overruns.assign(registry.size(), 0);
+    
+    for (const auto &shard: score_shards) {
+        for (size_t i = 0; i < registry.size(); ++i) {
+            player_points[i] += ScoreShard::read(shard->player_points[i]);
+            player_play_count[i] += ScoreShard::read(shard->player_play_count[i]);
+            player_overruns[i] += ScoreShard::read(shard->player_overruns[i]);
+        }
+    }
+    
+    score_shards.clear();
+}
+
+/*
+ * Every side of every match gets its own seed, which only depends on the master seed and the match itself.
+ * This way, the seeds don't depend on the worker that happens to play the match, or on when it is played.
+ */
+uint64_t TournamentManager::matchSeed(const WorkItem &work_item, int player_number) const
+{
+    /* Mixed, so neighbouring matches get unrelated seeds. */
+    uint64_t player_key = SeedStreams::mix(2 * static_cast<uint64_t>(work_item.index) +
+                                           static_cast<uint64_t>(player_number));
+    
+    return SeedStreams::mix(master_seed ^ player_key);
+}
+
+/* Plays a match on the given game of the worker, and records the overruns of its players. */
+template <class Player1, class Player2>
+GameResult TournamentManager::playGame(BasicGame<Player1, Player2> &game,
+                                       Player1 &player1,
+                                       Player2 &player2,
+                                       const WorkItem &work_item,
+                                       size_t worker_index)
+{
+    ScoreShard &shard = *score_shards[worker_index];
+    
+    game.reset();
+    game.setPhaseTimes(&worker_stats[worker_index].phase_times);
+    
+    if (nullptr != watchdog) {
+        WatchdogSlot &slot = watchdog->getSlot(worker_index);
+        slot.setPlayers(work_item.player1, work_item.player2);
+        game.setTimeBudget(time_budget.get(), &slot);
+    }
+    
+    PerfCounters *counters = getPerfCounters(worker_index);
+    
+    if (nullptr != counters) {
+        counters->start();
+    }
+    
+    GameResult result = game.run(player1, player2);
+    PerfSample sample;
+    
+    if (nullptr != counters && counters->stop(sample)) {
+        std::vector<PerfTotals> &player_perf = worker_stats[worker_index].player_perf;
         
-        if (work_item.should_terminate) {
-            break;
+        if (player_perf.empty()) {
+            player_perf.resize(registry.size());
         }
         
-        std::unique_ptr<PlayerAlgorithm> player1 = id_to_algorithm[work_item.player1_id]();
-        std::unique_ptr<PlayerAlgorithm> player2 = id_to_algorithm[work_item.player2_id]();
-        std::string message;
+        player_perf[work_item.player1].add(sample, result.move_count);
+        player_perf[work_item.player2].add(sample, result.move_count);
+    }
+    
+    /* Overruns are rare, so we don't touch the counters of a match without any. */
+    if (0 != game.getOverrunCount(1)) {
+        ScoreShard::add(shard.player_overruns[work_item.player1], game.getOverrunCount(1));
+    }
+    
+    if (0 != game.getOverrunCount(2)) {
+        ScoreShard::add(shard.player_overruns[work_item.player2], game.getOverrunCount(2));
+    }
+    
+    return result;
+}
+
+/*
+ * Plays a single match, on the game specialized for the built-in player if it takes part. The game that played it
+ * is left as the match ended, so it may still describe the result.
+ */
+GameResult TournamentManager::playMatch(const WorkItem &work_item, size_t worker_index)
+{
+    std::unique_ptr<PlayerAlgorithm> player1;
+    std::unique_ptr<PlayerAlgorithm> player2;
+    
+    if (sandbox_hosts.empty()) {
+        player1 = algorithm_pools[worker_index]->acquire(work_item.player1);
+        player2 = algorithm_pools[worker_index]->acquire(work_item.player2);
+    } else {
+        player1 = std::make_unique<SandboxedPlayerAlgorithm>(getSandbox(worker_index, 1), work_item.player1);
+        player2 = std::make_unique<SandboxedPlayerAlgorithm>(getSandbox(worker_index, 2), work_item.player2);
+    }
+    
+    SeededAlgorithm *seeded1 = dynamic_cast<SeededAlgorithm*>(player1.get());
+    SeededAlgorithm *seeded2 = dynamic_cast<SeededAlgorithm*>(player2.get());
+    
+    if (nullptr != seeded1) {
+        seeded1->setSeed(matchSeed(work_item, 1));
+    }
+    
+    if (nullptr != seeded2) {
+        seeded2->setSeed(matchSeed(work_item, 2));
+    }
+    
+    WorkerGames &worker_games = *games[worker_index];
+    GameResult result;
+    
+    /* Isolated players are only reached through their sandboxes, so only players that run in process qualify. */
+    bool is_builtin_first = sandbox_hosts.empty() && has_builtin_player && builtin_player == work_item.player1;
+    bool is_builtin_second = sandbox_hosts.empty() && has_builtin_player && builtin_player == work_item.player2;
+    
+    if (is_builtin_first) {
+        result = playGame(worker_games.builtin_first, static_cast<BuiltinPlayer&>(*player1), *player2,
+                          work_item, worker_index);
+        worker_games.last_game = &worker_games.builtin_first;
         
-        int winner = Game().run(*player1, *player2, message);
+    } else if (is_builtin_second) {
+        result = playGame(worker_games.builtin_second, *player1, static_cast<BuiltinPlayer&>(*player2),
+                          work_item, worker_index);
+        worker_games.last_game = &worker_games.builtin_second;
         
-        {
-            std::lock_guard<std::mutex> lock(global_stats_mutex);
-            updateWithItemResults(work_item, winner);
+    } else {
+        result = playGame(worker_games.game, *player1, *player2, work_item, worker_index);
+        worker_games.last_game = &worker_games.game;
+    }
+    
+    if (sandbox_hosts.empty()) {
+        algorithm_pools[worker_index]->release(work_item.player1, std::move(player1));
+        algorithm_pools[worker_index]->release(work_item.player2, std::move(player2));
+    }
+    
+    return result;
+}
+
+void TournamentManager::runOneMatch(const WorkItem &work_item, size_t worker_index)
+{
+    auto start = std::chrono::steady_clock::now();
+    GameResult result = playMatch(work_item, worker_index);
+    
+    worker_stats[worker_index].latency.record(std::chrono::steady_clock::now() - start);
+    updateWithItemResults(*score_shards[worker_index], work_item, result.winner);
+    
+    if (nullptr != match_log) {
+        match_log->append(work_item.index, result.winner);
+    }
+    
+    worker_stats[worker_index].games++;
+}
+
+/* Plays a single match of the schedule on the main thread, and explains how it ended. */
+void TournamentManager::replayMatch()
+{
+    RoundRobinSchedule schedule(registry.size(), TournamentManager::REQUIRED_GAMES);
+    WorkItem work_item;
+    bool found = false;
+    
+    createScoreShards(1);
+    worker_stats.assign(1, WorkerStats());
+    
+    while (!found && schedule.next(work_item)) {
+        found = (replay_index == work_item.index);
+    }
+    
+    if (!found) {
+        std::cerr << "Can't replay match " << replay_index << ", there are only " << countMatches()
+                  << " matches." << std::endl;
+        mergeScoreShards();
+        return;
+    }
+    
+    GameResult result = playMatch(work_item, 0);
+    
+    mergeScoreShards();
+    
+    std::cout << "Match " << replay_index << ": " << registry.getId(work_item.player1) << " against "
+              << registry.getId(work_item.player2) << std::endl;
+    
+    if (0 == result.winner) {
+        std::cout << "Tie" << std::endl;
+    } else {
+        std::cout << "Player " << result.winner << " won" << std::endl;
+    }
+    
+    std::cout << result.move_count << " moves, " << result.player1_pieces << " against " << result.player2_pieces
+              << " pieces left" << std::endl;
+    std::cout << games[0]->last_game->describeResult(result) << std::flush;
+}
+
+void TournamentManager::startWatchdog(size_t worker_count)
+{
+    /* The watchdog wakes up often enough to catch an overrun within half a budget. */
+    std::chrono::nanoseconds interval = std::min(time_budget->move_budget, time_budget->positions_budget) / 2;
+    interval = std::max<std::chrono::nanoseconds>(interval, std::chrono::milliseconds(1));
+    
+    /* Note: This may run while the watchdog is being destroyed, so it must not reach it through the member. */
+    auto on_overrun = [this](size_t worker_index, playerIndex player, std::chrono::nanoseconds running) {
+        std::cerr << "Watchdog: " << registry.getId(player) << " is running for "
+                  << std::chrono::duration<double, std::milli>(running).count() << " ms on worker " << worker_index << ", past its time budget" << std::endl;
+    };
+    
+    watchdog = std::make_unique<Watchdog>(worker_count, interval, on_overrun);
+}
+
+void TournamentManager::printOverruns() const
+{
+    std::cout << "Time budget overruns:" << std::endl;
+    
+    for (size_t i = 0; i < registry.size(); ++i) {
+        if (0 != player_overruns[i]) {
+            std::cout << registry.getId(static_cast<playerIndex>(i)) << " " << player_overruns[i] << std::endl;
         }
     }
+    
+    std::cout << "The watchdog flagged " << watchdog->getFlaggedCalls() << " calls while they were running"
+              << std::endl;
+}
+
+/* The counters only count the calling thread, so every worker opens its own, on its first match. */
+PerfCounters* TournamentManager::getPerfCounters(size_t worker_index)
+{
+    if (perf_counters.empty()) {
+        return nullptr;
+    }
+    
+    std::unique_ptr<PerfCounters> &counters = perf_counters[worker_index];
+    
+    if (nullptr == counters) {
+        counters = std::make_unique<PerfCounters>();
+        (void) counters->open();
+    }
+    
+    return counters->isOpen() ? counters.get() : nullptr;
 }
 
-void TournamentManager::createMatchesWork(std::vector<WorkItem> &work_vector)
+void TournamentManager::printPerfCounters() const
 {
-    std::map<std::string, size_t> scheduled_matches;
-    std::vector<std::string> all_ids;
+    bool is_available = false;
+    int open_error = 0;
     
-    for (const auto &pair: id_to_algorithm) {
-        all_ids.push_back(pair.first);
+    for (const auto &counters: perf_counters) {
+        if (nullptr == counters) {
+            continue;
+        }
+        
+        if (counters->isOpen()) {
+            is_available = true;
+        } else {
+            open_error = counters->getOpenError();
+        }
     }
     
-    assert(all_ids.size() > 1);
+    if (!is_available) {
+        std::cout << "Hardware counters are unavailable: " << strerror(open_error) << std::endl;
+        return;
+    }
     
-    /*
-     * This vector contains an entry for each possible player.
-     * The entry consists of a vector of play counts. The j'th entry in this vector
-     * contains the amount of scheduled matches against the j'th opponent.
-     * We use this vector to retrieve each time the opponent with which the current player
-     * had the least amount of plays.
-     */
-    std::vector<std::vector<size_t>> planned_games_count;
+    std::vector<PerfTotals> player_perf(registry.size());
     
-    for (size_t i = 0; i < all_ids.size(); ++i) {
-        planned_games_count.push_back(std::vector<size_t>(all_ids.size()));
-        /* 
-         * The diagonal corresponds to games with ourselves. We explicitly set this to the maximum possible count,
-         * so it will never get chosen.
-         */
-        planned_games_count[i][i] = std::numeric_limits<size_t>::max();
+    for (const auto &stats: worker_stats) {
+        for (size_t i = 0; i < stats.player_perf.size(); ++i) {
+            player_perf[i].merge(stats.player_perf[i]);
+        }
+    }
+    
+    std::cout << "Hardware counters per player, over the matches it played:" << std::endl;
+    
+    for (size_t i = 0; i < player_perf.size(); ++i) {
+        const PerfTotals &totals = player_perf[i];
+        
+        if (0 == totals.matches) {
+            continue;
+        }
+        
+        double ipc = (0 != totals.counters.cycles) ? (static_cast<double>(totals.counters.instructions) /
+                                                      totals.counters.cycles) : 0;
+        double moves = (0 != totals.moves) ? static_cast<double>(totals.moves) : 1;
+        
+        std::cout << registry.getId(static_cast<playerIndex>(i)) << ": " << totals.matches << " matches, IPC "
+                  << ipc << ", " << totals.counters.cache_misses / moves << " cache misses and "
+                  << totals.counters.branch_misses / moves << " branch misses per move" << std::endl;
+    }
+}
+
+/*
+ * Note: The hosts are forked before any worker thread or the watchdog is started, so the children are forked
+ * from a single threaded process. Only a host that crashed is forked again, from its worker's thread.
+ */
+void TournamentManager::startSandboxes(size_t worker_count)
+{
+    sandbox_hosts.clear();
+    
+    for (size_t i = 0; i < 2 * worker_count; ++i) {
+        sandbox_hosts.push_back(std::make_unique<SandboxHost>(registry));
+        
+        if (!sandbox_hosts.back()->start()) {
+            std::cerr << "Failed to start the sandboxes, running the players without isolation." << std::endl;
+            sandbox_hosts.clear();
+            return;
+        }
+    }
+}
+
+/* Returns the host of the given side of the worker's current match, after forking it again if it crashed. */
+SandboxHost& TournamentManager::getSandbox(size_t worker_index, int player_number)
+{
+    SandboxHost &host = *sandbox_hosts[2 * worker_index + (player_number - 1)];
+    
+    if (!host.isAlive()) {
+        std::cerr << "The sandbox of worker " << worker_index << " crashed while hosting "
+                  << registry.getId(host.getHostedPlayer()) << ", restarting it." << std::endl;
+        
+        if (!host.start()) {
+            /* The calls into the player will fail, so the player loses its matches rather than the tournament. */
+            std::cerr << "Failed to restart the sandbox of worker " << worker_index << std::endl;
+        }
+    }
+    
+    return host;
+}
+
+/* FNV-1a over the players and the schedule, so a log is only resumed by the very same tournament. */
+uint64_t TournamentManager::scheduleFingerprint() const
+{
+    uint64_t hash = 14695981039346656037ULL;
+    auto mix = [&hash](uint64_t value) {
+        for (size_t i = 0; i < sizeof(value); ++i) {
+            hash = (hash ^ ((value >> (8 * i)) & 0xff)) * 1099511628211ULL;
+        }
+    };
+    
+    for (size_t i = 0; i < registry.size(); ++i) {
+        for (char c: registry.getId(static_cast<playerIndex>(i))) {
+            mix(static_cast<unsigned char>(c));
+        }
+        
+        mix(0);
+    }
+    
+    RoundRobinSchedule schedule(registry.size(), TournamentManager::REQUIRED_GAMES);
+    WorkItem work_item;
+    
+    while (schedule.next(work_item)) {
+        mix((static_cast<uint64_t>(work_item.player1) << 32) | work_item.player2);
+    }
+    
+    return hash;
+}
+
+/*
+ * Credits the logged matches to the first shard, and marks them as finished. A match that was logged more than once
+ * is only credited once. Returns the amount of credited matches.
+ */
+size_t TournamentManager::creditLoggedMatches(std::vector<MatchLogEntry> &entries, size_t total_games)
+{
+    /* The log only holds the indices, so we walk the schedule along the sorted entries to find the players. */
+    std::sort(entries.begin(), entries.end(), [](const MatchLogEntry &a, const MatchLogEntry &b) {
+        return a.match_index < b.match_index;
+    });
+    
+    finished_matches.assign(total_games, false);
+    RoundRobinSchedule schedule(registry.size(), TournamentManager::REQUIRED_GAMES);
+    WorkItem work_item;
+    auto entry = entries.begin();
+    size_t credited = 0;
+    
+    while (entries.end() != entry && schedule.next(work_item)) {
+        if (work_item.index != entry->match_index) {
+            continue;
+        }
+        
+        /* The game numbers come from the whole schedule, so the points don't depend on who played the match. */
+        finished_matches[work_item.index] = true;
+        updateWithItemResults(*score_shards[0], work_item, entry->winner);
+        credited++;
+        
+        while (entries.end() != entry && work_item.index == entry->match_index) {
+            ++entry;
+        }
+    }
+    
+    return credited;
+}
+
+/* The amount of matches of our shard that were not played yet. */
+size_t TournamentManager::countPendingMatches(size_t total_games) const
+{
+    size_t pending = 0;
+    
+    for (size_t i = shard_index; i < total_games; i += shard_count) {
+        if (finished_matches.empty() || !finished_matches[i]) {
+            pending++;
+        }
+    }
+    
+    return pending;
+}
+
+/*
+ * Makes sure the log we were asked to resume belongs to this tournament, and takes the master seed from it unless
+ * one was given. A missing log is fine, the tournament simply starts over. Returns false if there is a log that
+ * can't be resumed, in which case it is left untouched.
+ */
+bool TournamentManager::prepareResume()
+{
+    if (0 != access(checkpoint_path.c_str(), F_OK)) {
+        return true;
+    }
+    
+    MatchLog log;
+    std::vector<MatchLogEntry> entries;
+    uint64_t log_seed;
+    
+    if (!log.read(checkpoint_path, countMatches(), scheduleFingerprint(), entries, log_seed)) {
+        std::cerr << "Can't resume from " << checkpoint_path << " - it belongs to another tournament." << std::endl;
+        return false;
+    }
+    
+    if (!has_master_seed) {
+        setMasterSeed(log_seed);
+    } else if (master_seed != log_seed) {
+        std::cerr << "Can't resume from " << checkpoint_path << " - its games were played with master seed "
+                  << log_seed << ", not " << master_seed << "." << std::endl;
+        return false;
     }
     
-    /* Generate the matches - we try to spread evenly as much as possible. */
-    for (size_t i = 0; i < planned_games_count.size(); ++i) {
-        std::string current = all_ids[i];
-        while (scheduled_matches[current] < TournamentManager::REQUIRED_GAMES) {
-            std::vector<size_t> &current_matches = planned_games_count[i];
+    return true;
+}
+
+/*
+ * Opens the match log, if one was requested. When resuming, the matches found in the log are credited to the
+ * first shard and marked as finished, so only the rest are played. Returns the amount of resumed matches.
+ * Note: The shards must exist before this is called, and no worker may be running yet.
+ */
+size_t TournamentManager::openMatchLog(size_t total_games)
+{
+    finished_matches.clear();
+    
+    if (checkpoint_path.empty()) {
+        return 0;
+    }
+    
+    match_log = std::make_unique<MatchLog>();
+    uint64_t fingerprint = scheduleFingerprint();
+    
+    if (should_resume) {
+        std::vector<MatchLogEntry> entries;
+        
+        if (match_log->open(checkpoint_path, total_games, fingerprint, master_seed, entries)) {
+            size_t resumed = creditLoggedMatches(entries, total_games);
             
-            size_t min_pos = std::distance(current_matches.begin(),
-                                           std::min_element(current_matches.begin(), current_matches.end()));
-            assert(0 <= min_pos && min_pos < all_ids.size());
+            std::cout << "Resumed " << resumed << " finished games from " << checkpoint_path << std::endl;
+            return resumed;
+        }
+        
+        /* A log that can't be resumed may still hold the results of another run, so it is never replaced. */
+        if (0 == access(checkpoint_path.c_str(), F_OK)) {
+            std::cerr << "Failed to resume from " << checkpoint_path << ", the matches will not be logged."
+                      << std::endl;
+            match_log = nullptr;
+            return 0;
+        }
+        
+        std::cout << "There is no match log at " << checkpoint_path << ", starting a new one." << std::endl;
+    }
+    
+    if (!match_log->create(checkpoint_path, total_games, fingerprint, master_seed)) {
+        std::cerr << "Failed to create the match log at " << checkpoint_path << ", the matches will not be logged."
+                  << std::endl;
+        match_log = nullptr;
+    }
+    
+    return 0;
+}
+
+/*
+ * The resumed games are already in the shards, but they were not played by this run, so they don't count towards
+ * its rate.
+ * Note: The shards must exist before this is called, and outlive the leaderboard.
+ */
+void TournamentManager::startLeaderboard(size_t total_games, size_t resumed_games)
+{
+    if (leaderboard_interval.count() <= 0) {
+        return;
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    leaderboard = std::make_unique<PeriodicReporter>(leaderboard_interval, [this, total_games, resumed_games, start] {
+        printLeaderboard(total_games, resumed_games, start);
+    });
+}
+
+/*
+ * Runs on the leaderboard thread, while the workers keep updating their shards. The counters are read one by one,
+ * so the snapshot may be off by the matches that finish while it is taken, but the workers are never stalled.
+ */
+void TournamentManager::printLeaderboard(size_t total_games,
+                                         size_t resumed_games,
+                                         std::chrono::steady_clock::time_point start) const
+{
+    std::vector<size_t> points(registry.size(), 0);
+    std::vector<size_t> play_count(registry.size(), 0);
+    size_t total_plays = 0;
+    
+    for (const auto &shard: score_shards) {
+        for (size_t i = 0; i < registry.size(); ++i) {
+            points[i] += ScoreShard::read(shard->player_points[i]);
+            play_count[i] += ScoreShard::read(shard->player_play_count[i]);
+        }
+    }
+    
+    std::vector<playerIndex> sorted;
+    
+    for (size_t i = 0; i < registry.size(); ++i) {
+        sorted.push_back(static_cast<playerIndex>(i));
+        total_plays += play_count[i];
+    }
+    
+    /* Every game is played by two players. */
+    size_t games = total_plays / 2;
+    size_t shown = std::min(leaderboard_size, sorted.size());
+    
+    std::partial_sort(sorted.begin(), sorted.begin() + shown, sorted.end(), [&](playerIndex a, playerIndex b) {
+        if (points[a] != points[b]) {
+            return points[a] > points[b];
+        }
+        
+        return registry.getId(a) < registry.getId(b);
+    });
+    
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    size_t played_games = games - std::min(resumed_games, games);
+    double rate = (elapsed.count() > 0) ? (played_games / elapsed.count()) : 0;
+    
+    /* The whole report is built first, so it isn't interleaved with other output. */
+    std::stringstream report;
+    report << "Leaderboard after " << games << "/" << total_games << " games (" << rate << " games/sec, ETA ";
+    
+    if (rate > 0) {
+        report << ((total_games - std::min(games, total_games)) / rate) << " seconds):" << std::endl;
+    } else {
+        report << "unknown):" << std::endl;
+    }
+    
+    for (size_t i = 0; i < shown; ++i) {
+        report << (i + 1) << ". " << registry.getId(sorted[i]) << " " << points[sorted[i]] << " points in "
+               << play_count[sorted[i]] << " games" << std::endl;
+    }
+    
+    std::cout << report.str() << std::flush;
+}
+
+/* Every worker, including the main thread, runs its scheduler loop through this. */
+void TournamentManager::runWorker(size_t worker_index, const std::function<void()> &loop)
+{
+    WorkerStats &stats = worker_stats[worker_index];
+    
+    if (!pinning_order.empty()) {
+        int cpu = pinning_order[worker_index % pinning_order.size()];
+        
+        if (ThreadPinning::pinCurrentThread(cpu)) {
+            stats.cpu = cpu;
+            stats.pinned = true;
+        } else {
+            std::cerr << "Failed to pin worker " << worker_index << " to cpu " << cpu << std::endl;
+        }
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    loop();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    
+    stats.elapsed_seconds = elapsed.count();
+    
+    if (!stats.pinned) {
+        stats.cpu = sched_getcpu();
+    }
+}
+
+void TournamentManager::printWorkerStats() const
+{
+    std::cout << "Per worker games/sec:" << std::endl;
+    
+    for (size_t i = 0; i < worker_stats.size(); ++i) {
+        const WorkerStats &stats = worker_stats[i];
+        double rate = (stats.elapsed_seconds > 0) ? (stats.games / stats.elapsed_seconds) : 0;
+        
+        std::cout << "Worker " << i << (stats.pinned ? " pinned to cpu " : " last seen on cpu ") << stats.cpu
+                  << ": " << stats.games << " games in " << stats.elapsed_seconds << " seconds ("
+                  << rate << " games/sec)" << std::endl;
+    }
+}
+
+/* Only the games played by this run are counted, a resumed run doesn't count the games it found in the log. */
+void TournamentManager::printThroughput(double elapsed_seconds) const
+{
+    LatencyHistogram latency;
+    size_t games = 0;
+    
+    for (const auto &stats: worker_stats) {
+        latency.merge(stats.latency);
+        games += stats.games;
+    }
+    
+    double rate = (elapsed_seconds > 0) ? (games / elapsed_seconds) : 0;
+    
+    std::cout << "Played " << games << " games in " << elapsed_seconds << " seconds (" << rate << " games/sec)"
+              << std::endl;
+    std::cout << "Match latency: p50 " << latency.percentileMs(0.5) << " ms, p99 " << latency.percentileMs(0.99)
+              << " ms" << std::endl;
+}
+
+void TournamentManager::printArenaStats() const
+{
+    size_t matches = 0;
+    size_t total_bytes = 0;
+    size_t total_allocations = 0;
+    size_t peak_bytes = 0;
+    
+    for (const auto &worker_games: games) {
+        for (const GameRules *game: {static_cast<const GameRules*>(&worker_games->game),
+                                     static_cast<const GameRules*>(&worker_games->builtin_first),
+                                     static_cast<const GameRules*>(&worker_games->builtin_second)}) {
+            const MatchArena &arena = game->getArena();
             
-            std::string opponent = all_ids[min_pos];
+            matches += arena.getMatchCount();
+            total_bytes += arena.getTotalBytes();
+            total_allocations += arena.getTotalAllocations();
+            peak_bytes = std::max(peak_bytes, arena.getPeakBytes());
+        }
+    }
+    
+    if (0 == matches) {
+        return;
+    }
+    
+    std::cout << "Match arena: " << total_bytes / matches << " bytes in " << total_allocations / matches
+              << " allocations per match, at most " << peak_bytes << " bytes in a single match" << std::endl;
+}
+
+void TournamentManager::printPhaseTimes() const
+{
+    GamePhaseTimes phase_times;
+    
+    for (const auto &stats: worker_stats) {
+        phase_times.merge(stats.phase_times);
+    }
+    
+    uint64_t total_nanoseconds = 0;
+    uint64_t total_calls = 0;
+    
+    for (size_t i = 0; i < GamePhaseTimes::PHASE_COUNT; ++i) {
+        total_nanoseconds += phase_times.nanoseconds[i];
+        total_calls += phase_times.calls[i];
+    }
+    
+    /* Nothing was timed, the phase timing is not compiled in. */
+    if (0 == total_calls) {
+        return;
+    }
+    
+    std::cout << "Game phase breakdown:" << std::endl;
+    
+    for (size_t i = 0; i < GamePhaseTimes::PHASE_COUNT; ++i) {
+        uint64_t calls = phase_times.calls[i];
+        double seconds = phase_times.nanoseconds[i] / 1e9;
+        double percent = (0 != total_nanoseconds) ? (100.0 * phase_times.nanoseconds[i] / total_nanoseconds) : 0;
+        double average_us = (0 != calls) ? (phase_times.nanoseconds[i] / 1e3 / calls) : 0;
+        
+        std::cout << GamePhaseTimes::getName(i) << ": " << seconds << " seconds (" << percent << "%), " << calls
+                  << " calls, " << average_us << " us per call" << std::endl;
+    }
+}
+
+void TournamentManager::workerThread(size_t worker_index)
+{
+    for (;;) {
+        const WorkItem &work_item = work_queue.pop();
+        
+        if (work_item.should_terminate) {
+            break;
+        }
+        
+        runOneMatch(work_item, worker_index);
+    }
+}
+
+void TournamentManager::stealingWorkerThread(WorkStealingQueue<WorkItem> &stealing_queue,
+                                             MatchSource &source,
+                                             size_t worker_index)
+{
+    std::vector<WorkItem> batch;
+    WorkItem work_item;
+    
+    for (;;) {
+        if (!stealing_queue.pop(worker_index, work_item)) {
+            /* Our deque is empty, and so are our peers'. We refill from the schedule, and only stop once it is over. */
+            batch.clear();
             
-            WorkItem item(current, opponent);
-            work_vector.push_back(item);
+            if (0 == source.take(TournamentManager::SOURCE_BATCH_SIZE, batch)) {
+                return;
+            }
             
-            scheduled_matches[current]++;
-            scheduled_matches[opponent]++;
+            for (const auto &item: batch) {
+                stealing_queue.push(worker_index, item);
+            }
             
-            planned_games_count[i][min_pos]++;
-            planned_games_count[min_pos][i]++;
+            continue;
         }
+        
+        runOneMatch(work_item, worker_index);
     }
 }
 
-void TournamentManager::runMatchesAsynchronously()
+void TournamentManager::ringWorkerThread(RingQueue<WorkItem> &ring_queue, size_t worker_index)
 {
-    std::vector<std::thread> threads;
+    std::vector<WorkItem> batch;
     
-    for (size_t i = 0; i < thread_count - 1; ++i) {
-        threads.push_back(std::thread(&TournamentManager::workerThread, this));
+    for (;;) {
+        batch.clear();
+        ring_queue.pop_batch(TournamentManager::RING_BATCH_SIZE, batch);
+        
+        for (auto it = batch.begin(); it != batch.end(); ++it) {
+            if (it->should_terminate) {
+                /*
+                 * The termination jobs are pushed after all the matches, so the rest of the batch can only
+                 * contain termination jobs of other workers. We hand them back.
+                 */
+                ring_queue.push_batch(it + 1, batch.end());
+                return;
+            }
+            
+            runOneMatch(*it, worker_index);
+        }
     }
+}
+
+/* The dispenser only decides the size of every chunk, and the matches themselves are taken from the schedule. */
+void TournamentManager::chunkedWorkerThread(ChunkDispenser &dispenser, MatchSource &source, size_t worker_index)
+{
+    std::vector<WorkItem> chunk;
+    size_t begin, end;
     
-    std::vector<WorkItem> work_vector;
-    createMatchesWork(work_vector);
-    
-    std::cout << "Generated " << work_vector.size() << " jobs" << std::endl;
+    while (dispenser.claim(begin, end)) {
+        chunk.clear();
+        (void) source.take(end - begin, chunk);
+        
+        for (const auto &work_item: chunk) {
+            runOneMatch(work_item, worker_index);
+        }
+    }
+}
+
+size_t TournamentManager::countMatches() const
+{
+    assert(registry.size() > 1);
     
-    /* We will push all the jobs, and additionally, we will create the termination jobs afterwards. */
-    work_queue.push(work_vector);
+    return RoundRobinSchedule::countMatches(registry.size(), TournamentManager::REQUIRED_GAMES);
+}
+
+void TournamentManager::runMatchesWithQueue(MatchSource &source)
+{
+    std::vector<std::thread> threads;
     
-    WorkItem termination_item(true);
-    for (size_t i = 0; i < threads.size(); ++i) {
-        work_queue.push(termination_item);
+    /* The main thread is worker 0, so we only spawn the rest. */
+    for (size_t i = 1; i < thread_count; ++i) {
+        threads.push_back(std::thread(&TournamentManager::runWorker, this, i, [this, i]{ workerThread(i); }));
     }
     
+    runWorker(0, [this, &source]{
+        /*
+         * We feed the queue from the schedule as the workers drain it. Whenever enough jobs are already queued,
+         * we play one of them ourselves instead, so the queue never holds more than a few batches.
+         */
+        std::vector<WorkItem> batch;
+        WorkItem work_item;
+        
+        while (0 != source.take(TournamentManager::SOURCE_BATCH_SIZE, batch)) {
+            work_queue.push(batch);
+            batch.clear();
+            
+            while (work_queue.size() >= thread_count * TournamentManager::SOURCE_BATCH_SIZE
+                   && work_queue.tryPop(work_item)) {
+                runOneMatch(work_item, 0);
+            }
+        }
+        
+        /* The termination jobs go after all the matches. */
+        WorkItem termination_item(true);
+        for (size_t i = 0; i < thread_count; ++i) {
+            work_queue.push(termination_item);
+        }
+        
+        /* Now we can lend a hand with the rest. */
+        workerThread(0);
+    });
+    
     /* Welp, time to wait for all the threads to terminate. */
     for (auto &thread: threads) {
         thread.join();
@@ -198,26 +1032,234 @@ void TournamentManager::runMatchesAsynchronously()
     assert(work_queue.empty());
 }
 
+void TournamentManager::runMatchesWithStealing(MatchSource &source)
+{
+    WorkStealingQueue<WorkItem> stealing_queue(thread_count);
+    std::vector<std::thread> threads;
+    
+    for (size_t i = 1; i < stealing_queue.workerCount(); ++i) {
+        threads.push_back(std::thread(&TournamentManager::runWorker,
+                                      this,
+                                      i,
+                                      [this, i, &stealing_queue, &source]{
+                                          stealingWorkerThread(stealing_queue, source, i);
+                                      }));
+    }
+    
+    runWorker(0, [this, &stealing_queue, &source]{ stealingWorkerThread(stealing_queue, source, 0); });
+    
+    for (auto &thread: threads) {
+        thread.join();
+    }
+    
+    assert(stealing_queue.empty());
+}
+
+void TournamentManager::runMatchesWithRing(MatchSource &source)
+{
+    RingQueue<WorkItem> ring_queue(TournamentManager::RING_CAPACITY);
+    std::vector<std::thread> threads;
+    
+    for (size_t i = 1; i < thread_count; ++i) {
+        threads.push_back(std::thread(&TournamentManager::runWorker,
+                                      this,
+                                      i,
+                                      [this, i, &ring_queue]{ ringWorkerThread(ring_queue, i); }));
+    }
+    
+    runWorker(0, [this, &ring_queue, &source]{
+        /* Whenever the ring is full, we play one of the queued matches ourselves instead of waiting. */
+        std::vector<WorkItem> batch;
+        WorkItem work_item;
+        
+        while (0 != source.take(TournamentManager::SOURCE_BATCH_SIZE, batch)) {
+            auto next = batch.begin();
+            
+            while (batch.end() != next) {
+                next += ring_queue.try_push_batch(next, batch.end());
+                
+                if (batch.end() != next && ring_queue.tryPop(work_item)) {
+                    runOneMatch(work_item, 0);
+                }
+            }
+            
+            batch.clear();
+        }
+        
+        std::vector<WorkItem> termination_items(thread_count, WorkItem(true));
+        ring_queue.push_batch(termination_items.begin(), termination_items.end());
+        
+        ringWorkerThread(ring_queue, 0);
+    });
+    
+    for (auto &thread: threads) {
+        thread.join();
+    }
+    
+    assert(ring_queue.empty());
+}
+
+void TournamentManager::runMatchesChunked(MatchSource &source, size_t pending_games)
+{
+    ChunkDispenser dispenser(pending_games, thread_count, chunk_policy);
+    std::vector<std::thread> threads;
+    
+    for (size_t i = 1; i < thread_count; ++i) {
+        threads.push_back(std::thread(&TournamentManager::runWorker,
+                                      this,
+                                      i,
+                                      [this, i, &dispenser, &source]{ chunkedWorkerThread(dispenser, source, i); }));
+    }
+    
+    runWorker(0, [this, &dispenser, &source]{ chunkedWorkerThread(dispenser, source, 0); });
+    
+    for (auto &thread: threads) {
+        thread.join();
+    }
+}
+
+void TournamentManager::runMatchesAsynchronously()
+{
+    size_t total_games = countMatches();
+    
+    std::cout << "Scheduled " << total_games << " jobs" << std::endl;
+    
+    /* Every worker, including the main thread, gets its own shard. */
+    createScoreShards(thread_count);
+    size_t resumed_games = openMatchLog(total_games);
+    size_t pending_games = countPendingMatches(total_games);
+    worker_stats.assign(thread_count, WorkerStats());
+    startLeaderboard((total_games + shard_count - 1 - shard_index) / shard_count, resumed_games);
+    
+    /* The matches are generated as the workers ask for them. */
+    MatchSource source(registry.size(), TournamentManager::REQUIRED_GAMES, finished_matches, shard_index, shard_count);
+    
+    /* The main thread is pinned as well, so we restore its original affinity once we are done. */
+    cpu_set_t original_affinity;
+    bool restore_affinity = ThreadPinning::getCurrentAffinity(original_affinity);
+    pinning_order = ThreadPinning::getPinningOrder(pinning_policy);
+    
+    if (PinningPolicy::NONE != pinning_policy && pinning_order.empty()) {
+        std::cerr << "Failed to retrieve the available cpus, the workers will not be pinned." << std::endl;
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    
+    switch (scheduler_type) {
+        case SchedulerType::QUEUE:
+            runMatchesWithQueue(source);
+            break;
+            
+        case SchedulerType::STEAL:
+            runMatchesWithStealing(source);
+            break;
+            
+        case SchedulerType::RING:
+            runMatchesWithRing(source);
+            break;
+            
+        case SchedulerType::CHUNKED:
+            runMatchesChunked(source, pending_games);
+            break;
+    }
+    
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    
+    if (restore_affinity) {
+        (void) ThreadPinning::setCurrentAffinity(original_affinity);
+    }
+    
+    /* The leaderboard reads the shards, so it is stopped before they are merged. */
+    leaderboard = nullptr;
+    mergeScoreShards();
+    
+    printThroughput(elapsed.count());
+    printWorkerStats();
+    printPhaseTimes();
+    printArenaStats();
+}
+
 void TournamentManager::runMatchesSynchronously()
 {
-    std::vector<WorkItem> work_vector;
-    createMatchesWork(work_vector);
+    size_t total_games = countMatches();
     
-    for (const auto &work_item: work_vector) {
-        std::unique_ptr<PlayerAlgorithm> player1 = id_to_algorithm[work_item.player1_id]();
-        std::unique_ptr<PlayerAlgorithm> player2 = id_to_algorithm[work_item.player2_id]();
-        std::string message;
+    createScoreShards(1);
+    size_t resumed_games = openMatchLog(total_games);
+    worker_stats.assign(1, WorkerStats());
+    startLeaderboard((total_games + shard_count - 1 - shard_index) / shard_count, resumed_games);
+    
+    MatchSource source(registry.size(), TournamentManager::REQUIRED_GAMES, finished_matches, shard_index, shard_count);
+    std::vector<WorkItem> batch;
+    auto start = std::chrono::steady_clock::now();
+    
+    while (0 != source.take(TournamentManager::SOURCE_BATCH_SIZE, batch)) {
+        for (const auto &work_item: batch) {
+            runOneMatch(work_item, 0);
+        }
         
-        Game game;
-        int winner = game.run(*player1, *player2, message);
-        updateWithItemResults(work_item, winner);
+        batch.clear();
     }
+    
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    
+    leaderboard = nullptr;
+    mergeScoreShards();
+    
+    printThroughput(elapsed.count());
+    printPhaseTimes();
+    printArenaStats();
 }
 
 void TournamentManager::runMatches()
 {
     std::cout << "Going to run.. " << std::endl;
-    if (thread_count > 1) {
+    
+    if (should_resume && !prepareResume()) {
+        return;
+    }
+    
+    if (!has_master_seed) {
+        std::random_device device;
+        setMasterSeed((static_cast<uint64_t>(device()) << 32) | device());
+    }
+    
+    /* Passing this seed back with -seed reproduces the tournament. */
+    std::cout << "Master seed: " << master_seed << std::endl;
+    
+    size_t worker_count = should_replay ? 1 : thread_count;
+    
+    if (IsolationMode::PROCESS == isolation_mode) {
+        startSandboxes(worker_count);
+    }
+    
+    if (nullptr != time_budget) {
+        startWatchdog(worker_count);
+    }
+    
+    if (should_sample_perf) {
+        perf_counters.clear();
+        perf_counters.resize(worker_count);
+    }
+    
+    games.clear();
+    
+    for (size_t i = 0; i < worker_count; ++i) {
+        games.push_back(std::make_unique<WorkerGames>());
+    }
+    
+    /* Isolated players are created by their sandboxes, so only the players that run in process are pooled. */
+    algorithm_pools.clear();
+    
+    if (sandbox_hosts.empty()) {
+        for (size_t i = 0; i < worker_count; ++i) {
+            algorithm_pools.push_back(std::make_unique<AlgorithmPool>(registry));
+        }
+    }
+    
+    if (should_replay) {
+        replayMatch();
+    
+    } else if (thread_count > 1) {
         std::cout << "Running asynchronously.. " << std::endl;
         runMatchesAsynchronously();
     
@@ -226,37 +1268,129 @@ void TournamentManager::runMatches()
         runMatchesSynchronously();
     }
     
+    if (nullptr != watchdog) {
+        printOverruns();
+        watchdog = nullptr;
+    }
+    
+    if (!perf_counters.empty()) {
+        printPerfCounters();
+        perf_counters.clear();
+    }
+    
+    /* Shuts the children down. */
+    sandbox_hosts.clear();
+    algorithm_pools.clear();
+    games.clear();
+    
+    /* Flushes the log. It is kept, so resuming a finished tournament just prints its results. */
+    match_log = nullptr;
+    
+    if (should_replay) {
+        return;
+    }
+    
+    if (shard_count > 1) {
+        /* The points of a single shard mean nothing by themselves. */
+        std::cout << "Wrote the results of shard " << shard_index << "/" << shard_count << " to " << checkpoint_path
+                  << ", combine all the shards with -merge" << std::endl;
+        return;
+    }
+    
+    printResults();
+}
+
+void TournamentManager::printResults() const
+{
     /* Let's print the results. */
     std::cout << "Printing results.. " << std::endl;
                 
-    std::vector<std::pair<std::string, size_t>> sorted;
+    std::vector<playerIndex> sorted;
     
-    for (const auto &element: id_to_points) {
-        sorted.push_back(element);
+    for (size_t i = 0; i < registry.size(); ++i) {
+        sorted.push_back(static_cast<playerIndex>(i));
     }
     
-    auto comparer = [](std::pair<std::string, size_t> a,
-                       std::pair<std::string, size_t> b) -> bool 
+    /* Ties are broken by the id, so the printing order is stable. */
+    auto comparer = [&](playerIndex a, playerIndex b) -> bool 
                 {
-                    return a.second > b.second;
+                    if (player_points[a] != player_points[b]) {
+                        return player_points[a] > player_points[b];
+                    }
+                    
+                    return registry.getId(a) < registry.getId(b);
                 };
     
     std::sort(sorted.begin(), sorted.end(), comparer);  
     
-    for (const auto &pair: sorted) {
-        std::cout << pair.first << " " << pair.second << std::endl;
+    for (const auto &player: sorted) {
+        std::cout << registry.getId(player) << " " << player_points[player] << std::endl;
+    }
+}
+
+/*
+ * Combines the logs written by the shards of a tournament into its final results. Every match is credited
+ * the same way a single process would have credited it, so the results are the same.
+ */
+void TournamentManager::mergeShards()
+{
+    size_t total_games = countMatches();
+    uint64_t fingerprint = scheduleFingerprint();
+    std::vector<MatchLogEntry> entries;
+    uint64_t shards_seed = 0;
+    bool is_first_shard = true;
+    
+    for (const auto &path: merge_paths) {
+        MatchLog shard_log;
+        size_t previous_size = entries.size();
+        uint64_t shard_seed;
+        
+        /* The shards' logs are only read, so merging never changes them. */
+        if (!shard_log.read(path, total_games, fingerprint, entries, shard_seed)) {
+            std::cerr << "Failed to read the results in " << path
+                      << " - it is missing or belongs to another tournament." << std::endl;
+            return;
+        }
+        
+        /* Shards that were played with different seeds are parts of different tournaments. */
+        if (!is_first_shard && shards_seed != shard_seed) {
+            std::cerr << "The results in " << path << " were played with master seed " << shard_seed
+                      << ", while the previous shards were played with " << shards_seed << "." << std::endl;
+            return;
+        }
+        
+        shards_seed = shard_seed;
+        is_first_shard = false;
+        std::cout << "Read " << (entries.size() - previous_size) << " games from " << path << std::endl;
     }
+    
+    createScoreShards(1);
+    size_t merged = creditLoggedMatches(entries, total_games);
+    mergeScoreShards();
+    finished_matches.clear();
+    
+    if (merged != total_games) {
+        std::cerr << (total_games - merged) << " of " << total_games
+                  << " games are missing from the shards, the results are partial." << std::endl;
+    }
+    
+    printResults();
 }
 
 void TournamentManager::run()
 {
     loadAllPlayers();
     
-    if (player_count < 2) {
+    if (registry.size() < 2) {
         std::cerr << "Please supply at least 2 players in the so directory." << std::endl;
         return;
     }
     
+    if (!merge_paths.empty()) {
+        mergeShards();
+        return;
+    }
+    
     runMatches();
 }
 
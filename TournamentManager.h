@@ -7,49 +7,230 @@
 #include <string>
 #include <map>
 #include <mutex>
+#include <type_traits>
+#include <atomic>
+#include <chrono>
 
 #include <stdlib.h>
+#include <stdint.h>
 
 #include "PlayerAlgorithm.h"
+#include "PlayerRegistry.h"
 #include "BlockingQueue.h"
+#include "WorkStealingQueue.h"
+#include "RingQueue.h"
+#include "ThreadPinning.h"
+#include "ChunkDispenser.h"
+#include "TimeBudget.h"
+#include "SandboxHost.h"
+#include "PeriodicReporter.h"
+#include "MatchLog.h"
+#include "WorkItem.h"
+#include "RoundRobinSchedule.h"
+#include "MatchSource.h"
+#include "LatencyHistogram.h"
+#include "GamePhaseTimes.h"
+#include "PerfCounters.h"
+#include "AlgorithmPool.h"
+#include "Game.h"
 
-using playerAlgorithmPtr = std::function<std::unique_ptr<PlayerAlgorithm>()>;
-
-/* 
- * We define WorkItem here although it is not part of the actual interface since it is needed for BlockingQueue
- * I have chosen to implement a producer consumer model, where each worker threads retrieves a job from the work queue,
- * process it, and updates the global state. To indicate that no more work is to be done, a special termination job
- * is pushed to the queue.
+/*
+ * The results accumulated by a single worker thread. Every worker owns one, so updating it requires no locking.
+ * The shards are merged once all the workers are done. Every array of counters is padded by a cache line on both
+ * sides, so the counters of different workers never share a cache line.
+ * The counters are atomic only so the live leaderboard may read them while the workers are running.
+ * Since every counter has a single writer, an update is a relaxed load and store rather than a locked instruction.
  */
-struct WorkItem
+struct ScoreShard
 {
+private:
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+    
 public:
-    bool should_terminate;
-    const std::string player1_id;
-    const std::string player2_id;
-    
-    WorkItem(const std::string &id1, const std::string &id2) :should_terminate(false), player1_id(id1), player2_id(id2) {}
-    WorkItem(): should_terminate(false), player1_id(), player2_id() {}
-    WorkItem(bool should_terminate, const std::string &id1, const std::string &id2): should_terminate(should_terminate),
-                                                                         player1_id(id1),
-                                                                         player2_id(id2) {}
-    WorkItem(bool should_terminate): WorkItem(should_terminate, std::string(), std::string()) {}
+    /* Indexed by the player index. */
+    class Counters
+    {
+    private:
+        static constexpr size_t PADDING = CACHE_LINE_SIZE / sizeof(std::atomic<size_t>);
+        
+        std::vector<std::atomic<size_t>> counters;
+        
+    public:
+        Counters(size_t count): counters(count + 2 * PADDING) {}
+        
+        std::atomic<size_t>& operator[](size_t index) { return counters[PADDING + index]; }
+        const std::atomic<size_t>& operator[](size_t index) const { return counters[PADDING + index]; }
+    };
+    
+    Counters player_play_count;
+    Counters player_points;
+    Counters player_overruns;
+    
+    ScoreShard(size_t player_count): player_play_count(player_count),
+                                     player_points(player_count),
+                                     player_overruns(player_count) {}
+    
+    /* Note: Must only be called by the owning worker. */
+    static void add(std::atomic<size_t> &counter, size_t how_much)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + how_much, std::memory_order_relaxed);
+    }
+    
+    static size_t read(const std::atomic<size_t> &counter) { return counter.load(std::memory_order_relaxed); }
+};
+
+/* Per worker statistics, used to spot imbalance between the workers (and the cores they run on). */
+struct WorkerStats
+{
+private:
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+    
+public:
+    /* The cpu the worker was pinned to, or the last cpu it was seen on if it wasn't pinned. */
+    int cpu;
+    bool pinned;
+    size_t games;
+    double elapsed_seconds;
+    /* From creating the players to the end of the game. */
+    LatencyHistogram latency;
+    /* Stays empty unless the phase timing is compiled in. */
+    GamePhaseTimes phase_times;
+    /* Indexed by the player index. Stays empty unless the hardware counters are sampled. */
+    std::vector<PerfTotals> player_perf;
+    char padding[CACHE_LINE_SIZE];
+    
+    WorkerStats(): cpu(-1),
+                   pinned(false),
+                   games(0),
+                   elapsed_seconds(0),
+                   latency(),
+                   phase_times(),
+                   player_perf(),
+                   padding() {}
+};
+
+/* The player compiled into the executable. Its matches are played by games that call into it directly. */
+using BuiltinPlayer = RSPPlayer_305261901;
+
+/*
+ * The games of a single worker, reset before each of its matches. A player never plays against itself, so with
+ * a single built-in player a match is either played by one of the games specialized for it, or by the game
+ * that plays any two algorithms.
+ */
+struct WorkerGames
+{
+    Game game;
+    BasicGame<BuiltinPlayer, PlayerAlgorithm> builtin_first;
+    BasicGame<PlayerAlgorithm, BuiltinPlayer> builtin_second;
+    /* The game that played the last match, which is the one that may describe its result. */
+    const GameRules *last_game;
+    
+    WorkerGames(): game(), builtin_first(), builtin_second(), last_game(&game) {}
+};
+
+/* The outcome of loading a single player's shared object. */
+struct PluginLoadResult
+{
+    std::string name;
+    bool loaded;
+    /* Reading the file in, which the loader threads do in parallel. */
+    double prefetch_seconds;
+    /*
+     * The dlopen itself, as wall time. The dynamic loader serializes dlopen calls, so this includes waiting
+     * for the loads of the other threads.
+     */
+    double open_seconds;
+    std::string error;
+    
+    PluginLoadResult(const std::string &name): name(name),
+                                               loaded(false),
+                                               prefetch_seconds(0),
+                                               open_seconds(0),
+                                               error() {}
+};
+
+/* The way matches are distributed between the worker threads. */
+enum class SchedulerType
+{
+    /* A single shared BlockingQueue, from which every worker pops. */
+    QUEUE,
+    /* Per worker deques, where idle workers steal from their peers. */
+    STEAL,
+    /* A single shared lock free RingQueue, from which every worker pops batches. */
+    RING,
+    /* Workers claim ranges of the schedule directly, according to a ChunkPolicy. */
+    CHUNKED
 };
 
 class TournamentManager
 {
 private:
     static constexpr size_t REQUIRED_GAMES = 30;
+    static constexpr size_t RING_CAPACITY = 1024;
+    static constexpr size_t RING_BATCH_SIZE = 8;
+    /* The amount of matches taken from the schedule at once. */
+    static constexpr size_t SOURCE_BATCH_SIZE = 32;
+    static const char * const BUILTIN_PLAYER_ID;
     
-    std::map<std::string, playerAlgorithmPtr> id_to_algorithm;
+    PlayerRegistry registry;
     std::string so_directory;
     size_t thread_count;
+    SchedulerType scheduler_type;
+    PinningPolicy pinning_policy;
+    ChunkPolicy chunk_policy;
+    /* The cpus the workers are pinned to, in order. Empty if the workers are not pinned. */
+    std::vector<int> pinning_order;
+    
+    std::vector<std::unique_ptr<ScoreShard>> score_shards;
+    std::vector<WorkerStats> worker_stats;
+    std::vector<size_t> player_play_count;
+    std::vector<size_t> player_points;
+    std::vector<size_t> player_overruns;
+    
+    /* Calls into the players are only timed if a budget was set. */
+    std::unique_ptr<TimeBudget> time_budget;
+    std::unique_ptr<Watchdog> watchdog;
+    
+    /* One per worker, opened by the worker on its first match. Empty unless the hardware counters are sampled. */
+    bool should_sample_perf;
+    std::vector<std::unique_ptr<PerfCounters>> perf_counters;
+    
+    /* The live leaderboard is only printed if an interval was set. */
+    std::chrono::nanoseconds leaderboard_interval;
+    size_t leaderboard_size;
+    std::unique_ptr<PeriodicReporter> leaderboard;
+    
+    /* Finished matches are only logged if a checkpoint path was set. */
+    std::string checkpoint_path;
+    bool should_resume;
+    std::unique_ptr<MatchLog> match_log;
+    /* Indexed by the match index. Only filled when resuming, with the matches found in the log. */
+    std::vector<bool> finished_matches;
+    
+    /* Every match is seeded from the master seed, so the whole tournament can be reproduced. */
+    uint64_t master_seed;
+    bool has_master_seed;
+    /* If set, only the match at this index of the schedule is played. */
+    bool should_replay;
+    size_t replay_index;
+    
+    /* Only the matches whose index is shard_index modulo shard_count are played by this process. */
+    size_t shard_index;
+    size_t shard_count;
+    /* If set, the logs of the shards at these paths are merged, instead of playing. */
+    std::vector<std::string> merge_paths;
     
-    std::mutex global_stats_mutex;
-    std::map<std::string, size_t> id_to_play_count;
-    std::map<std::string, size_t> id_to_points;
+    IsolationMode isolation_mode;
+    /* Two hosts per worker, one for each side of the match. Empty unless the players are isolated. */
+    std::vector<std::unique_ptr<SandboxHost>> sandbox_hosts;
+    /* One per worker, with the idle instances of the players it played. Empty if the players are isolated. */
+    std::vector<std::unique_ptr<AlgorithmPool>> algorithm_pools;
+    /* One per worker. */
+    std::vector<std::unique_ptr<WorkerGames>> games;
+    /* Set if the built-in player was loaded, in which case the registry creates it from the executable. */
+    bool has_builtin_player;
+    playerIndex builtin_player;
     
-    size_t player_count;
     BlockingQueue<WorkItem> work_queue;
     /* 
      * The tournament manager will be a singleton. Therefore, we forbid
@@ -57,25 +238,96 @@ private:
      * variables instantiation fiascos, so we still use a single instance that has its access
      * serialized via the public getInstance method.
      */
-    TournamentManager(): id_to_algorithm(),
+    TournamentManager(): registry(),
                          so_directory("./"),
                          thread_count(4),
-                         global_stats_mutex(),
-                         id_to_play_count(),
-                         id_to_points(),
-                         player_count(0),
+                         scheduler_type(SchedulerType::QUEUE),
+                         pinning_policy(PinningPolicy::NONE),
+                         chunk_policy(ChunkPolicy::guidedPolicy()),
+                         pinning_order(),
+                         score_shards(),
+                         worker_stats(),
+                         player_play_count(),
+                         player_points(),
+                         player_overruns(),
+                         time_budget(),
+                         watchdog(),
+                         should_sample_perf(false),
+                         perf_counters(),
+                         leaderboard_interval(0),
+                         leaderboard_size(10),
+                         leaderboard(),
+                         checkpoint_path(),
+                         should_resume(false),
+                         match_log(),
+                         finished_matches(),
+                         master_seed(0),
+                         has_master_seed(false),
+                         should_replay(false),
+                         replay_index(0),
+                         shard_index(0),
+                         shard_count(1),
+                         merge_paths(),
+                         isolation_mode(IsolationMode::NONE),
+                         sandbox_hosts(),
+                         algorithm_pools(),
+                         games(),
+                         has_builtin_player(false),
+                         builtin_player(0),
                          work_queue()
                          {}
     
+    std::vector<std::string> findPlayerFiles() const;
+    void loadPlayer(PluginLoadResult &result) const;
     void loadAllPlayers();
-    void createMatchesWork(std::vector<WorkItem> &work_vector);
-    void runOneMatch();
+    size_t countMatches() const;
+    uint64_t matchSeed(const WorkItem &work_item, int player_number) const;
+    GameResult playMatch(const WorkItem &work_item, size_t worker_index);
+    template <class Player1, class Player2>
+    GameResult playGame(BasicGame<Player1, Player2> &game,
+                        Player1 &player1,
+                        Player2 &player2,
+                        const WorkItem &work_item,
+                        size_t worker_index);
+    void runOneMatch(const WorkItem &work_item, size_t worker_index);
+    void replayMatch();
+    void runWorker(size_t worker_index, const std::function<void()> &loop);
+    void printWorkerStats() const;
+    void printThroughput(double elapsed_seconds) const;
+    void printPhaseTimes() const;
+    void printArenaStats() const;
+    void startWatchdog(size_t worker_count);
+    void printOverruns() const;
+    PerfCounters* getPerfCounters(size_t worker_index);
+    void printPerfCounters() const;
+    void startSandboxes(size_t worker_count);
+    void startLeaderboard(size_t total_games, size_t resumed_games);
+    uint64_t scheduleFingerprint() const;
+    size_t creditLoggedMatches(std::vector<MatchLogEntry> &entries, size_t total_games);
+    size_t countPendingMatches(size_t total_games) const;
+    bool prepareResume();
+    size_t openMatchLog(size_t total_games);
+    void printLeaderboard(size_t total_games,
+                          size_t resumed_games,
+                          std::chrono::steady_clock::time_point start) const;
+    SandboxHost& getSandbox(size_t worker_index, int player_number);
+    void runMatchesWithQueue(MatchSource &source);
+    void runMatchesWithStealing(MatchSource &source);
+    void runMatchesWithRing(MatchSource &source);
+    void runMatchesChunked(MatchSource &source, size_t pending_games);
     void runMatchesAsynchronously();
     void runMatchesSynchronously();
     void runMatches();
-    void workerThread();
-    void incrementIfNeeded(const std::string &id, size_t how_much);
-    void updateWithItemResults(const WorkItem &work_item, int winner);
+    void printResults() const;
+    void mergeShards();
+    void workerThread(size_t worker_index);
+    void stealingWorkerThread(WorkStealingQueue<WorkItem> &stealing_queue, MatchSource &source, size_t worker_index);
+    void ringWorkerThread(RingQueue<WorkItem> &ring_queue, size_t worker_index);
+    void chunkedWorkerThread(ChunkDispenser &dispenser, MatchSource &source, size_t worker_index);
+    void createScoreShards(size_t count);
+    void mergeScoreShards();
+    void incrementIfNeeded(ScoreShard &shard, playerIndex player, size_t game_number, size_t how_much);
+    void updateWithItemResults(ScoreShard &shard, const WorkItem &work_item, int winner);
 
 public:
     static TournamentManager& getInstance()
@@ -85,11 +337,7 @@ public:
         return instance;
     }
     
-    void onPlayerRegistration(std::string &id, playerAlgorithmPtr algorithm)
-    {
-        id_to_algorithm[id] = algorithm;
-        player_count++;
-    }
+    void onPlayerRegistration(std::string &id, playerAlgorithmPtr algorithm);
     
     void setSODirectory(const std::string &so_directory)
     { 
@@ -101,6 +349,52 @@ public:
     
     void setThreadCount(size_t thread_count) { this->thread_count = thread_count; }
     
+    void setSchedulerType(SchedulerType scheduler_type) { this->scheduler_type = scheduler_type; }
+    
+    void setPinningPolicy(PinningPolicy pinning_policy) { this->pinning_policy = pinning_policy; }
+    
+    void setChunkPolicy(ChunkPolicy chunk_policy) { this->chunk_policy = chunk_policy; }
+    
+    void setTimeBudget(const TimeBudget &time_budget) { this->time_budget = std::make_unique<TimeBudget>(time_budget); }
+    
+    void setIsolationMode(IsolationMode isolation_mode) { this->isolation_mode = isolation_mode; }
+    
+    void setPerfSampling(bool should_sample_perf) { this->should_sample_perf = should_sample_perf; }
+    
+    void setLeaderboard(std::chrono::nanoseconds interval, size_t size)
+    {
+        leaderboard_interval = interval;
+        leaderboard_size = size;
+    }
+    
+    /* If should_resume is set, the matches found in the log at the given path are not played again. */
+    void setCheckpoint(const std::string &path, bool should_resume)
+    {
+        checkpoint_path = path;
+        this->should_resume = should_resume;
+    }
+    
+    void setMasterSeed(uint64_t master_seed)
+    {
+        this->master_seed = master_seed;
+        has_master_seed = true;
+    }
+    
+    void setReplay(size_t replay_index)
+    {
+        should_replay = true;
+        this->replay_index = replay_index;
+    }
+    
+    /* Note: The shard is expected to be less than the count. */
+    void setShard(size_t shard_index, size_t shard_count)
+    {
+        this->shard_index = shard_index;
+        this->shard_count = shard_count;
+    }
+    
+    void setMergePaths(const std::vector<std::string> &merge_paths) { this->merge_paths = merge_paths; }
+    
     void run();
 };
 
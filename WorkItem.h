@@ -0,0 +1,59 @@
+/*
+ * Author: Nadav Markus
+ * A single match of the schedule, as handed to the worker threads.
+ */
+
+#ifndef __WORK_ITEM_H_
+#define __WORK_ITEM_H_
+
+#include <type_traits>
+
+#include <stdint.h>
+
+#include "PlayerRegistry.h"
+
+/* 
+ * WorkItem is not part of the actual interface of the tournament manager, but it is needed by the schedulers.
+ * I have chosen to implement a producer consumer model, where each worker threads retrieves a job from the work queue,
+ * process it, and updates the global state. To indicate that no more work is to be done, a special termination job
+ * is pushed to the queue.
+ */
+struct WorkItem
+{
+public:
+    bool should_terminate;
+    /* The position of the match in the schedule, which identifies it in the match log. */
+    uint32_t index;
+    playerIndex player1;
+    playerIndex player2;
+    /*
+     * The amount of matches scheduled for each player before this one, in schedule order.
+     * Only a player's first REQUIRED_GAMES matches count towards its points, and this is how we know
+     * which matches these are, regardless of the order in which the workers happen to finish them.
+     */
+    uint32_t player1_game_number;
+    uint32_t player2_game_number;
+    
+    WorkItem(uint32_t index,
+             playerIndex player1,
+             playerIndex player2,
+             uint32_t game_number1,
+             uint32_t game_number2): should_terminate(false),
+                                     index(index),
+                                     player1(player1),
+                                     player2(player2),
+                                     player1_game_number(game_number1),
+                                     player2_game_number(game_number2) {}
+    WorkItem(): WorkItem(false) {}
+    WorkItem(bool should_terminate): should_terminate(should_terminate),
+                                     index(0),
+                                     player1(0),
+                                     player2(0),
+                                     player1_game_number(0),
+                                     player2_game_number(0) {}
+};
+
+/* Work items are copied around by every scheduler, so we make sure that this is as cheap as a memcpy. */
+static_assert(std::is_trivially_copyable<WorkItem>::value, "WorkItem should be trivially copyable");
+
+#endif
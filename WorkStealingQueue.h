@@ -0,0 +1,137 @@
+/*
+ * Author: Nadav Markus
+ * A work stealing scheduler. Every worker owns a deque of jobs, which it consumes from the front.
+ * When a worker runs out of jobs, it steals half of the jobs of one of its peers, starting from
+ * the back of the peer's deque. Since each deque is almost always touched only by its owner,
+ * the locks here are practically uncontended, unlike the single lock of BlockingQueue.
+ * Note: A failed pop only means that there was nothing to steal when the deques were checked. It is up
+ * to the worker to know whether more jobs may still be pushed.
+ */
+
+#ifndef __WORK_STEALING_QUEUE_H_
+#define __WORK_STEALING_QUEUE_H_
+
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <memory>
+
+#include <stdlib.h>
+
+template <class T>
+class WorkStealingQueue
+{
+private:
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    /* The padding makes sure that the locks of two workers never share a cache line. */
+    struct WorkerDeque
+    {
+        std::mutex deque_mutex;
+        std::deque<T> items;
+        char padding[CACHE_LINE_SIZE];
+
+        WorkerDeque(): deque_mutex(), items(), padding() {}
+    };
+
+    std::vector<std::unique_ptr<WorkerDeque>> deques;
+
+    bool popOwn(size_t worker_index, T &result)
+    {
+        WorkerDeque &own = *deques[worker_index];
+        std::lock_guard<std::mutex> lock(own.deque_mutex);
+
+        if (own.items.empty()) {
+            return false;
+        }
+
+        result = std::move(own.items.front());
+        own.items.pop_front();
+        return true;
+    }
+
+    /* Steals half of the victim's jobs. The first stolen job is returned, and the rest are moved to our deque. */
+    bool stealFrom(size_t victim_index, size_t worker_index, T &result)
+    {
+        std::vector<T> stolen;
+
+        {
+            WorkerDeque &victim = *deques[victim_index];
+            std::lock_guard<std::mutex> lock(victim.deque_mutex);
+
+            size_t to_steal = (victim.items.size() + 1) / 2;
+
+            for (size_t i = 0; i < to_steal; ++i) {
+                stolen.push_back(std::move(victim.items.back()));
+                victim.items.pop_back();
+            }
+        }
+
+        if (stolen.empty()) {
+            return false;
+        }
+
+        result = std::move(stolen.back());
+        stolen.pop_back();
+
+        if (!stolen.empty()) {
+            WorkerDeque &own = *deques[worker_index];
+            std::lock_guard<std::mutex> lock(own.deque_mutex);
+
+            /* The stolen jobs were taken from the back, so we restore their original order. */
+            for (auto it = stolen.rbegin(); it != stolen.rend(); ++it) {
+                own.items.push_back(std::move(*it));
+            }
+        }
+
+        return true;
+    }
+
+public:
+    WorkStealingQueue(size_t worker_count): deques()
+    {
+        for (size_t i = 0; i < worker_count; ++i) {
+            deques.push_back(std::make_unique<WorkerDeque>());
+        }
+    }
+
+    size_t workerCount() const { return deques.size(); }
+
+    void push(size_t worker_index, const T &element)
+    {
+        WorkerDeque &own = *deques[worker_index];
+        std::lock_guard<std::mutex> lock(own.deque_mutex);
+        own.items.push_back(element);
+    }
+
+    /* Returns false only when no work is left for this worker, neither in its deque nor in its peers' deques. */
+    bool pop(size_t worker_index, T &result)
+    {
+        if (popOwn(worker_index, result)) {
+            return true;
+        }
+
+        for (size_t i = 1; i < deques.size(); ++i) {
+            if (stealFrom((worker_index + i) % deques.size(), worker_index, result)) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool empty() const
+    {
+        for (const auto &worker_deque: deques) {
+            std::lock_guard<std::mutex> lock(worker_deque->deque_mutex);
+
+            if (!worker_deque->items.empty()) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,75 @@
+#!/bin/bash
+# Runs the tournament on a fixed field at 1, 2, 4, ... threads, and reports the throughput, the match latency
+# and the parallel efficiency (the speedup over a single thread, divided by the amount of threads).
+# If a baseline file exists, the throughput is compared against it, and a drop of more than the tolerance fails.
+#
+# Usage: bench.sh <executable> <field dir> <max threads> <output file> <baseline file> <tolerance percent>
+
+set -e
+
+EXECUTABLE=$1
+FIELD_DIR=$2
+MAX_THREADS=$3
+OUTPUT=$4
+BASELINE=$5
+TOLERANCE=$6
+
+THREAD_COUNTS=""
+THREADS=1
+
+while [ "$THREADS" -lt "$MAX_THREADS" ]; do
+    THREAD_COUNTS="$THREAD_COUNTS $THREADS"
+    THREADS=$((THREADS * 2))
+done
+
+THREAD_COUNTS="$THREAD_COUNTS $MAX_THREADS"
+
+echo "threads games_per_sec p50_ms p99_ms efficiency" > "$OUTPUT"
+SINGLE_RATE=""
+
+for THREADS in $THREAD_COUNTS; do
+    # The seed is fixed, so every run plays the very same games.
+    RESULT=$("$EXECUTABLE" -path="$FIELD_DIR" -threads="$THREADS" -seed=1 | awk '
+        /^Played/ { rate = $7; sub(/\(/, "", rate) }
+        /^Match latency/ { p50 = $4; p99 = $7 }
+        END { print rate, p50, p99 }')
+
+    read RATE P50 P99 <<< "$RESULT"
+
+    # A change to the wording of the output would otherwise compare empty values, and always pass.
+    if [ -z "$RATE" ] || [ -z "$P50" ] || [ -z "$P99" ]; then
+        echo "Failed to parse the throughput and the latency of the run with $THREADS threads." >&2
+        exit 1
+    fi
+
+    if [ -z "$SINGLE_RATE" ]; then
+        SINGLE_RATE=$RATE
+    fi
+
+    EFFICIENCY=$(awk -v rate="$RATE" -v single="$SINGLE_RATE" -v threads="$THREADS" \
+                 'BEGIN { printf "%.2f", rate / (single * threads) }')
+    echo "$THREADS $RATE $P50 $P99 $EFFICIENCY" >> "$OUTPUT"
+done
+
+awk '{ printf "%-8s %-14s %-8s %-8s %s\n", $1, $2, $3, $4, $5 }' "$OUTPUT"
+
+if [ ! -f "$BASELINE" ]; then
+    echo "No baseline at $BASELINE, run 'make bench_baseline' to record this run as the baseline."
+    exit 0
+fi
+
+echo "Compared to $BASELINE:"
+
+# Only the thread counts that appear in both runs are compared.
+awk -v tolerance="$TOLERANCE" '
+    FNR == 1 { next }
+    NR == FNR { baseline[$1] = $2; next }
+    ($1 in baseline) {
+        change = 100 * ($2 - baseline[$1]) / baseline[$1]
+        verdict = (change < -tolerance) ? "REGRESSION" : "ok"
+        printf "%s threads: %.1f games/sec, baseline %.1f (%+.1f%%) %s\n", $1, $2, baseline[$1], change, verdict
+        if (change < -tolerance) {
+            failed = 1
+        }
+    }
+    END { exit failed }' "$BASELINE" "$OUTPUT"
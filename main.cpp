@@ -1,6 +1,7 @@
 #include <cassert>
 #include <string>
 #include <iostream>
+#include <chrono>
 
 /* We resort to raw getopt since we don't have boost :( */
 #include <getopt.h>
@@ -12,10 +13,37 @@ int main(int argc, char *const argv[])
     struct option options[] {
         {"threads", required_argument, nullptr, 0},
         {"path", required_argument, nullptr, 0},
+        {"scheduler", required_argument, nullptr, 0},
+        {"pin", required_argument, nullptr, 0},
+        {"chunk", required_argument, nullptr, 0},
+        {"budget", required_argument, nullptr, 0},
+        {"overrun", required_argument, nullptr, 0},
+        {"isolation", required_argument, nullptr, 0},
+        {"leaderboard", required_argument, nullptr, 0},
+        {"top", required_argument, nullptr, 0},
+        {"checkpoint", required_argument, nullptr, 0},
+        {"resume", no_argument, nullptr, 0},
+        {"seed", required_argument, nullptr, 0},
+        {"match", required_argument, nullptr, 0},
+        {"shard", required_argument, nullptr, 0},
+        {"merge", no_argument, nullptr, 0},
+        {"perf", no_argument, nullptr, 0},
         {nullptr, 0, nullptr, 0}
     };
 
     TournamentManager &tournament_manager = TournamentManager::getInstance();
+    /* The budget is only enabled if given, while the policy may be given in any order relative to it. */
+    double budget_ms = 0;
+    OverrunPolicy overrun_policy = OverrunPolicy::WARN;
+    /* Same goes for the leaderboard and its size. */
+    double leaderboard_seconds = 0;
+    size_t leaderboard_size = 10;
+    /* Resuming needs the log, which may be given after it. */
+    std::string checkpoint_path;
+    bool should_resume = false;
+    /* The shards to merge are given as the rest of the arguments. */
+    bool should_merge = false;
+    bool is_sharded = false;
     
     int longindex;
     while (-1 != getopt_long_only(argc, argv, "", options, &longindex)) {
@@ -43,7 +71,215 @@ int main(int argc, char *const argv[])
                 /* Set the path. */
                 tournament_manager.setSODirectory(std::string(optarg));
                 break;
+                
+            case 2:
+                /* Set the way matches are distributed between the threads. */
+                if (std::string("queue") == optarg) {
+                    tournament_manager.setSchedulerType(SchedulerType::QUEUE);
+                } else if (std::string("steal") == optarg) {
+                    tournament_manager.setSchedulerType(SchedulerType::STEAL);
+                } else if (std::string("ring") == optarg) {
+                    tournament_manager.setSchedulerType(SchedulerType::RING);
+                } else if (std::string("chunked") == optarg) {
+                    tournament_manager.setSchedulerType(SchedulerType::CHUNKED);
+                } else {
+                    std::cerr << "Unknown scheduler: " << optarg << ". Expected queue, steal, ring or chunked."
+                              << std::endl;
+                    return -1;
+                }
+                
+                break;
             
+            case 3:
+                /* Set how the worker threads are pinned to cores. */
+                if (std::string("none") == optarg) {
+                    tournament_manager.setPinningPolicy(PinningPolicy::NONE);
+                } else if (std::string("compact") == optarg) {
+                    tournament_manager.setPinningPolicy(PinningPolicy::COMPACT);
+                } else if (std::string("scatter") == optarg) {
+                    tournament_manager.setPinningPolicy(PinningPolicy::SCATTER);
+                } else {
+                    std::cerr << "Unknown pinning policy: " << optarg << ". Expected compact, scatter or none." << std::endl;
+                    return -1;
+                }
+                
+                break;
+                
+            case 4:
+                /* Set the chunk policy of the chunked scheduler - either guided or a fixed chunk size. */
+                if (std::string("guided") == optarg) {
+                    tournament_manager.setChunkPolicy(ChunkPolicy::guidedPolicy());
+                    break;
+                }
+                
+                try {
+                    int size = std::stoi(std::string(optarg));
+                    
+                    if (size < 1) {
+                        std::cerr << "The chunk size should be at least 1." << std::endl;
+                        return -1;
+                    }
+                    
+                    tournament_manager.setChunkPolicy(ChunkPolicy::fixedPolicy(static_cast<size_t>(size)));
+                } catch (const std::exception &error) {
+                    std::cerr << "Failed to parse the chunk policy: " << optarg << ". Expected guided or a size."
+                              << std::endl;
+                    return -1;
+                }
+                
+                break;
+                
+            case 5:
+                /* The time budget of every call into a player, in milliseconds. */
+                try {
+                    budget_ms = std::stod(std::string(optarg));
+                } catch (const std::exception &error) {
+                    budget_ms = 0;
+                }
+                
+                if (budget_ms <= 0) {
+                    std::cerr << "Failed to parse the time budget: " << optarg << std::endl;
+                    return -1;
+                }
+                
+                break;
+                
+            case 6:
+                /* What happens to a player that exceeds its time budget. */
+                if (std::string("forfeit") == optarg) {
+                    overrun_policy = OverrunPolicy::FORFEIT;
+                } else if (std::string("warn") == optarg) {
+                    overrun_policy = OverrunPolicy::WARN;
+                } else {
+                    std::cerr << "Unknown overrun policy: " << optarg << ". Expected forfeit or warn." << std::endl;
+                    return -1;
+                }
+                
+                break;
+                
+            case 7:
+                /* Whether the players run inside sandbox processes, so a crashing player can't bring us down. */
+                if (std::string("process") == optarg) {
+                    tournament_manager.setIsolationMode(IsolationMode::PROCESS);
+                } else if (std::string("none") == optarg) {
+                    tournament_manager.setIsolationMode(IsolationMode::NONE);
+                } else {
+                    std::cerr << "Unknown isolation mode: " << optarg << ". Expected process or none." << std::endl;
+                    return -1;
+                }
+                
+                break;
+                
+            case 8:
+                /* How often the live leaderboard is printed, in seconds. */
+                try {
+                    leaderboard_seconds = std::stod(std::string(optarg));
+                } catch (const std::exception &error) {
+                    leaderboard_seconds = 0;
+                }
+                
+                if (leaderboard_seconds <= 0) {
+                    std::cerr << "Failed to parse the leaderboard interval: " << optarg << std::endl;
+                    return -1;
+                }
+                
+                break;
+                
+            case 9:
+                /* The amount of players shown on the live leaderboard. */
+                try {
+                    int size = std::stoi(std::string(optarg));
+                    
+                    if (size < 1) {
+                        std::cerr << "The leaderboard size should be at least 1." << std::endl;
+                        return -1;
+                    }
+                    
+                    leaderboard_size = static_cast<size_t>(size);
+                } catch (const std::exception &error) {
+                    std::cerr << "Failed to parse the leaderboard size: " << optarg << std::endl;
+                    return -1;
+                }
+                
+                break;
+                
+            case 10:
+                /* Where the finished matches are logged, so an interrupted tournament may be resumed. */
+                checkpoint_path = optarg;
+                break;
+                
+            case 11:
+                /* Only play the matches that are missing from the log. */
+                should_resume = true;
+                break;
+                
+            case 12:
+                /* The master seed, from which the seed of every match is derived. */
+                try {
+                    tournament_manager.setMasterSeed(static_cast<uint64_t>(std::stoull(std::string(optarg))));
+                } catch (const std::exception &error) {
+                    std::cerr << "Failed to parse the seed: " << optarg << std::endl;
+                    return -1;
+                }
+                
+                break;
+                
+            case 13:
+                /* Only play a single match of the schedule, by its index. */
+                try {
+                    int index = std::stoi(std::string(optarg));
+                    
+                    if (index < 0) {
+                        std::cerr << "The match index should not be negative." << std::endl;
+                        return -1;
+                    }
+                    
+                    tournament_manager.setReplay(static_cast<size_t>(index));
+                } catch (const std::exception &error) {
+                    std::cerr << "Failed to parse the match index: " << optarg << std::endl;
+                    return -1;
+                }
+                
+                break;
+                
+            case 14:
+            {
+                /* Only play a slice of the schedule, given as index/count. */
+                std::string shard(optarg);
+                size_t separator = shard.find('/');
+                int index = -1;
+                int count = 0;
+                
+                try {
+                    if (std::string::npos != separator) {
+                        index = std::stoi(shard.substr(0, separator));
+                        count = std::stoi(shard.substr(separator + 1));
+                    }
+                } catch (const std::exception &error) {
+                    index = -1;
+                }
+                
+                if (index < 0 || count < 1 || index >= count) {
+                    std::cerr << "Failed to parse the shard: " << optarg << ". Expected index/count, such as 0/4."
+                              << std::endl;
+                    return -1;
+                }
+                
+                tournament_manager.setShard(static_cast<size_t>(index), static_cast<size_t>(count));
+                is_sharded = true;
+                break;
+            }
+                
+            case 15:
+                /* Combine the results of the shards instead of playing. */
+                should_merge = true;
+                break;
+                
+            case 16:
+                /* Sample the hardware counters around every game. */
+                tournament_manager.setPerfSampling(true);
+                break;
+                
             default:
                 /* Should not happen. */
                 assert(false);
@@ -51,6 +287,41 @@ int main(int argc, char *const argv[])
         }
     }
     
+    if (budget_ms > 0) {
+        std::chrono::nanoseconds budget(static_cast<int64_t>(budget_ms * 1000 * 1000));
+        tournament_manager.setTimeBudget(TimeBudget(budget, budget, overrun_policy));
+    }
+    
+    if (leaderboard_seconds > 0) {
+        std::chrono::nanoseconds interval(static_cast<int64_t>(leaderboard_seconds * 1000 * 1000 * 1000));
+        tournament_manager.setLeaderboard(interval, leaderboard_size);
+    }
+    
+    if (should_resume && checkpoint_path.empty()) {
+        std::cerr << "Resuming requires the log of the interrupted tournament, given by -checkpoint." << std::endl;
+        return -1;
+    }
+    
+    if (!checkpoint_path.empty()) {
+        tournament_manager.setCheckpoint(checkpoint_path, should_resume);
+    }
+    
+    if (is_sharded && checkpoint_path.empty()) {
+        std::cerr << "A shard writes its results to the log given by -checkpoint." << std::endl;
+        return -1;
+    }
+    
+    if (should_merge) {
+        std::vector<std::string> merge_paths(argv + optind, argv + argc);
+        
+        if (merge_paths.empty() || is_sharded) {
+            std::cerr << "Merging expects the logs of all the shards, as the rest of the arguments." << std::endl;
+            return -1;
+        }
+        
+        tournament_manager.setMergePaths(merge_paths);
+    }
+    
     tournament_manager.run();
     
     return 0;